@@ -17,8 +17,10 @@ public:
 };
 
 auto main() -> int {
-  Spektral::Log::ConsoleLogger &cl =
-      Spektral::Log::ConsoleLogger::get_inst(Spektral::Log::LogLevel::INFO);
+  // The loop outruns the terminal: wait for room instead of throwing.
+  Spektral::Log::ConsoleLogger &cl = Spektral::Log::ConsoleLogger::get_inst(
+      Spektral::Log::LogLevel::INFO, Spektral::Log::WaitStrategy::PARK,
+      Spektral::Log::ClockSource::SYSTEM, Spektral::Log::OverflowPolicy::BLOCK);
   for (int ii = 0; ii <= 500000; ++ii)
     cl.insert({Spektral::Log::LogLevel::INFO,
                 Spektral::Log::Source<std::string>::Make("main"),
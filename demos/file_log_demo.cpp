@@ -4,8 +4,10 @@
 #include "Sources.hpp"
 
 int main() {
-  Spektral::Log::FileLogger fl =
-      Spektral::Log::FileLogger("output_logs/file_demo.log");
+  // The loop outruns the disk: wait for room instead of throwing.
+  Spektral::Log::FileLogger fl = Spektral::Log::FileLogger(
+      "output_logs/file_demo.log",
+      {.overflow = Spektral::Log::OverflowPolicy::BLOCK});
   for (int ii = 0; ii <= 500000; ++ii)
     fl.insert({Spektral::Log::LogLevel::INFO,
                Spektral::Log::Source<std::string>::Make("main"),
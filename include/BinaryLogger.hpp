@@ -0,0 +1,333 @@
+/// @file: include/BinaryLogger.hpp
+/// @brief: a logger that defers all formatting to an offline decoder.
+///
+/// 1. defines the binary wire format in Spektral::Log::Binary.
+/// 2. provides class BinaryLogger, whose hot path only copies a format string
+/// id, a raw timestamp and the raw argument bytes.
+/// 3. provides the SPEKTRAL_BINLOG macro, which logs with a format string
+/// literal identified at compile time.
+
+#pragma once
+#include "Clock.hpp"
+#include "LogEvent.hpp"
+#include "Messages.hpp"
+#include "RingBuffer.hpp"
+#include "Sinks.hpp"
+#include "StagingQueue.hpp"
+#include "WaitStrategy.hpp"
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+
+#ifndef LOG_BINARY_LANE_SZ
+/**
+ * @brief Size in bytes of each thread's BinaryLogger lane.
+ *
+ * Must be a power of two. Can be overridden at compile time with
+ * -DLOG_BINARY_LANE_SZ=...
+ */
+#define LOG_BINARY_LANE_SZ (1 << 20)
+#endif
+
+namespace Spektral::Log {
+
+/**
+ * @namespace Spektral::Log::Binary
+ * @brief The BinaryLogger file format.
+ *
+ * A file is a FileHeader followed by chunks. Every chunk starts with a
+ * ChunkHeader and holds `records` records of its type:
+ * - DICT: [u64 format id][u32 length][format string]
+ * - EVENTS: [u32 length][EventHeader][source][arguments]
+ *
+ * Every argument is an ArgTag followed by its value: 8 bytes for I64, U64 and
+ * F64, 1 byte for BOOL and CHAR, [u32 length][bytes] for STR.
+ *
+ * A format string's DICT record is always written before the first chunk that
+ * references it. Chunks do not depend on each other otherwise, so once the
+ * dictionary is known they can be decoded in any order. All integers are in
+ * host byte order.
+ */
+namespace Binary {
+
+/// Identifies a BinaryLogger file.
+inline constexpr char file_magic[8] = {'S', 'P', 'K', 'B', 'L', 'O', 'G', '1'};
+/// Version of the format described here.
+inline constexpr std::uint32_t format_version = 1;
+/// Starts every chunk ("SPKC").
+inline constexpr std::uint32_t chunk_magic = 0x434B5053;
+
+/// The kind of records a chunk holds.
+enum class ChunkType : std::uint8_t {
+  DICT = 1,  ///< Format strings
+  EVENTS = 2 ///< Log events
+};
+
+/// The type of an encoded argument.
+enum class ArgTag : std::uint8_t {
+  I64 = 1,
+  U64 = 2,
+  F64 = 3,
+  BOOL = 4,
+  CHAR = 5,
+  STR = 6
+};
+
+/// First bytes of a file.
+struct FileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+};
+
+/// First bytes of a chunk.
+struct ChunkHeader {
+  std::uint32_t magic;
+  ChunkType type;
+  std::uint8_t reserved[3];
+  std::uint32_t payload_len; ///< Bytes following this header
+  std::uint32_t records;     ///< Records in the payload
+};
+
+/// Fixed part of an event record.
+struct EventHeader {
+  std::uint64_t fmt_id;    ///< Format string id
+  std::int64_t time_ns;    ///< Nanoseconds since the system_clock epoch
+  std::uint32_t source_len; ///< Bytes of source following the header
+  LogLevel level;
+  std::uint8_t nargs; ///< Arguments following the source
+  std::uint16_t reserved;
+};
+
+/// Format string ids are the ones Format<Fmt>::id computes at compile time.
+using Spektral::Log::format_id;
+
+/**
+ * @brief Concept for the argument types BinaryLogger can encode without
+ * formatting them.
+ */
+template <typename T>
+concept Encodable = std::is_arithmetic_v<T> ||
+                    std::convertible_to<const T &, std::string_view>;
+
+/// The ArgTag used for T.
+template <Encodable T> constexpr ArgTag tag_of() {
+  if constexpr (std::same_as<T, bool>)
+    return ArgTag::BOOL;
+  else if constexpr (std::same_as<T, char>)
+    return ArgTag::CHAR;
+  else if constexpr (std::is_floating_point_v<T>)
+    return ArgTag::F64;
+  else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+    return ArgTag::I64;
+  else if constexpr (std::is_integral_v<T>)
+    return ArgTag::U64;
+  else
+    return ArgTag::STR;
+}
+
+/// The number of bytes encode() writes for val.
+template <Encodable T> constexpr std::size_t encoded_size(const T &val) {
+  constexpr ArgTag tag = tag_of<T>();
+  if constexpr (tag == ArgTag::BOOL || tag == ArgTag::CHAR)
+    return 2;
+  else if constexpr (tag == ArgTag::STR)
+    return 1 + sizeof(std::uint32_t) + std::string_view(val).size();
+  else
+    return 1 + 8;
+}
+
+/// Writes val at out and advances out past it.
+template <Encodable T> void encode(char *&out, const T &val) {
+  constexpr ArgTag tag = tag_of<T>();
+  *out++ = static_cast<char>(tag);
+  if constexpr (tag == ArgTag::BOOL || tag == ArgTag::CHAR) {
+    *out++ = static_cast<char>(val);
+  } else if constexpr (tag == ArgTag::STR) {
+    std::string_view str(val);
+    auto len = static_cast<std::uint32_t>(str.size());
+    std::memcpy(out, &len, sizeof(len));
+    std::memcpy(out + sizeof(len), str.data(), str.size());
+    out += sizeof(len) + str.size();
+  } else {
+    using wire_t = std::conditional_t<
+        tag == ArgTag::F64, double,
+        std::conditional_t<tag == ArgTag::I64, std::int64_t, std::uint64_t>>;
+    auto wire = static_cast<wire_t>(val);
+    std::memcpy(out, &wire, sizeof(wire));
+    out += sizeof(wire);
+  }
+}
+
+} // namespace Binary
+
+/**
+ * @class BinaryLogger
+ * @brief Logs events in the compact binary format described in
+ * Spektral::Log::Binary.
+ *
+ * log() never formats anything: it copies the format string id, the raw
+ * timestamp, the source and the raw bytes of each argument into the calling
+ * thread's lane and returns. A background thread moves the records into chunks
+ * and writes them to the file, adding the dictionary entries for format strings
+ * it has not written yet. Turning the file into text is left to an offline
+ * decoder.
+ *
+ * Example:
+ * @code
+ * BinaryLogger bl("logs/network.bin");
+ * bl.log<"sent {} bytes to {}">(LogLevel::INFO, "main", n, host);
+ * @endcode
+ */
+class BinaryLogger {
+public:
+  /**
+   * @brief Constructor that takes a file path to which logs will be written.
+   *
+   * @param file_path The file path to the file to log to. Truncated.
+   * @param wait What the background thread does while there is nothing to
+   * log. Default: WaitStrategy::PARK.
+   * @param clock Where log() takes its timestamps from. Default:
+   * ClockSource::SYSTEM.
+   *
+   * @throws std::runtime_error If the file cannot be opened.
+   */
+  explicit BinaryLogger(const std::string &file_path,
+                        WaitStrategy wait = WaitStrategy::PARK,
+                        ClockSource clock = ClockSource::SYSTEM);
+
+  /**
+   * @brief Destructor.
+   *
+   * Writes every pending record before returning.
+   */
+  ~BinaryLogger();
+
+  /**
+   * @brief Registers a format string built at runtime with the process-wide
+   * dictionary.
+   *
+   * Thread-safe. Registering the same string twice is harmless. The string is
+   * copied; literals should go through log<Fmt>() instead.
+   *
+   * @param fmt A std::format format string.
+   * @return The id to pass to log(), i.e. Binary::format_id(fmt).
+   */
+  static std::uint64_t register_format(std::string_view fmt);
+
+  /**
+   * @brief Logs an event without formatting it.
+   *
+   * @param level The severity level of the event.
+   * @param fmt_id The id returned by register_format().
+   * @param source The source of the event. Copied.
+   * @param args The arguments of the format string. Arithmetic values are
+   * copied as is and anything convertible to std::string_view is copied as
+   * bytes.
+   *
+   * @throw full_queue_exception If the calling thread's lane is full.
+   */
+  template <Binary::Encodable... Args>
+  void log(LogLevel level, std::uint64_t fmt_id, std::string_view source,
+           const Args &...args) {
+    static_assert(sizeof...(Args) < 256, "Too many arguments");
+    std::size_t sz = sizeof(Binary::EventHeader) + source.size() +
+                     (Binary::encoded_size(args) + ... + 0);
+    SpscByteRing &lane = _lanes.local();
+    char *out = lane.reserve(sz);
+    if (!out)
+      throw_full(level);
+    Binary::EventHeader hdr{fmt_id,
+                            _clock.now().time_since_epoch() /
+                                std::chrono::nanoseconds(1),
+                            static_cast<std::uint32_t>(source.size()),
+                            level,
+                            static_cast<std::uint8_t>(sizeof...(Args)),
+                            0};
+    std::memcpy(out, &hdr, sizeof(hdr));
+    out += sizeof(hdr);
+    std::memcpy(out, source.data(), source.size());
+    out += source.size();
+    (Binary::encode(out, args), ...);
+    lane.commit();
+    _waiter.notify();
+  }
+
+  /**
+   * @brief Logs an event with a format string literal.
+   *
+   * The format string is checked against the argument types at compile time
+   * and its id is a compile-time constant. The first call registers the
+   * literal itself with the dictionary, without copying it.
+   *
+   * @tparam Fmt The format string.
+   * @param level The severity level of the event.
+   * @param source The source of the event. Copied.
+   * @param args The arguments of the format string.
+   *
+   * @throw full_queue_exception If the calling thread's lane is full.
+   */
+  template <FixedString Fmt, Binary::Encodable... Args>
+  void log(LogLevel level, std::string_view source, const Args &...args) {
+    static_assert(Format<Fmt>::template check<Args...>());
+    static const bool registered =
+        register_static(Format<Fmt>::id, Format<Fmt>::str);
+    (void)registered;
+    log(level, Format<Fmt>::id, source, args...);
+  }
+
+private:
+  /// Adds fmt, which must have static storage duration, to the dictionary.
+  static bool register_static(std::uint64_t id, std::string_view fmt);
+
+  /// Throws full_queue_exception; kept out of line to keep log() small.
+  [[noreturn]] static void throw_full(LogLevel level);
+
+  /**
+   * @brief Starts the background thread.
+   *
+   * @param can_continue A reference to the atomic flag used to signal the
+   *                     background thread to stop.
+   * @return A future that can be used to wait for the background thread to
+   *         terminate.
+   */
+  [[nodiscard("Return is the value to stop the thread. Do not discard.")]]
+  std::future<void> start_backend(std::atomic<bool> &can_continue);
+
+  /// Timestamps the events.
+  const Clock _clock;
+  /// Where chunks are written to.
+  std::unique_ptr<ISink> _sink;
+  /// One byte ring per logging thread.
+  ThreadLanes<SpscByteRing> _lanes;
+  /// Format ids whose DICT record is already in the file.
+  std::unordered_set<std::uint64_t> _written_formats;
+  /// Atomic flag to control the background thread.
+  std::atomic<bool> _can_continue;
+  /// Parks the background thread while every lane is empty.
+  Waiter _waiter;
+  /// Future representing the background thread.
+  std::future<void> _ref;
+};
+
+} // namespace Spektral::Log
+
+/**
+ * @brief Logs through a BinaryLogger with a format string literal, see
+ * BinaryLogger::log<Fmt>().
+ *
+ * @param logger A BinaryLogger.
+ * @param level The LogLevel of the event.
+ * @param source The source of the event.
+ * @param fmt A string literal std::format format string.
+ * @param ... The arguments of fmt.
+ */
+#define SPEKTRAL_BINLOG(logger, level, source, fmt, ...)                       \
+  (logger).template log<fmt>(level, source __VA_OPT__(, ) __VA_ARGS__)
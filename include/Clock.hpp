@@ -0,0 +1,137 @@
+/// @file: include/Clock.hpp
+/// @brief: where loggers take their timestamps from.
+///
+/// 1. defines the ClockSource enum, selectable per logger.
+/// 2. provides class Clock, which reads the selected source as a std_time_t.
+
+#pragma once
+#include "LogEvent.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Spektral::Log {
+
+/**
+ * @enum ClockSource
+ * @brief Defines how a logger timestamps its events.
+ *
+ * - SYSTEM: std::chrono::system_clock::now(). Usually a vDSO call, but it
+ *   can fall back to a system call, e.g. on VMs without a stable TSC.
+ * - STEADY: std::chrono::steady_clock::now(), shifted to wall time when the
+ *   Clock is created. Monotonic; ignores later adjustments of the system
+ *   clock.
+ * - TSC: The CPU's time stamp counter (rdtsc), converted to wall time with a
+ *   scale a background thread keeps calibrated against the steady clock. A
+ *   few nanoseconds per event. Monotonic: when the system clock goes back,
+ *   TSC time runs up to 500ppm slower until it has caught up. Only used when
+ *   the CPU reports an invariant TSC; otherwise SYSTEM is used instead.
+ */
+enum class ClockSource : char {
+  SYSTEM = 0, ///< system_clock
+  STEADY = 1, ///< steady_clock anchored to wall time
+  TSC = 2     ///< rdtsc with background calibration
+};
+
+/**
+ * @class Clock
+ * @brief Reads a ClockSource as a wall clock std_time_t.
+ *
+ * Copyable and cheap to call from any thread.
+ */
+class Clock {
+public:
+  /**
+   * @brief Constructs a Clock.
+   *
+   * Selecting ClockSource::TSC for the first time in the process calibrates
+   * the counter for about 10ms and starts the calibration thread.
+   *
+   * @param source The ClockSource to read. Default: SYSTEM.
+   */
+  explicit Clock(ClockSource source = ClockSource::SYSTEM);
+
+  /// The source actually read, SYSTEM when TSC was requested but is
+  /// unavailable.
+  ClockSource source() const noexcept { return _source; }
+
+  /// Whether the CPU has an invariant TSC, i.e. whether ClockSource::TSC is
+  /// honoured.
+  static bool tsc_available() noexcept;
+
+  /// The current time.
+  std_time_t now() const noexcept {
+    switch (_source) {
+    case ClockSource::TSC:
+      return tsc_now();
+    case ClockSource::STEADY:
+      return std_time_t(std::chrono::duration_cast<std_clock::duration>(
+                            std::chrono::steady_clock::now().time_since_epoch()) +
+                        _steady_offset);
+    case ClockSource::SYSTEM:
+    default:
+      return std_clock::now();
+    }
+  }
+
+private:
+  /**
+   * @brief The conversion from ticks to wall time, published by the
+   * calibration thread under a sequence lock.
+   *
+   * now = ns_base + (ticks - tsc_base) * ns_per_tick. The thread moves the
+   * base forward every time it recalibrates so that the product stays small,
+   * and never publishes a conversion that would make now go back.
+   */
+  struct TscCalibration {
+    /// Odd while the thread is writing.
+    std::atomic<std::uint32_t> seq{0};
+    std::atomic<std::int64_t> tsc_base{0};
+    std::atomic<std::int64_t> ns_base{0};
+    std::atomic<double> ns_per_tick{0};
+  };
+  static TscCalibration _tsc;
+
+  /// Reads the time stamp counter.
+  static std::int64_t rdtsc() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return static_cast<std::int64_t>(__rdtsc());
+#else
+    return 0;
+#endif
+  }
+
+  /// Converts the current tick count to wall time.
+  static std_time_t tsc_now() noexcept {
+    std::int64_t ticks = rdtsc();
+    std::uint32_t seq;
+    std::int64_t tsc_base, ns_base;
+    double ns_per_tick;
+    do {
+      seq = _tsc.seq.load(std::memory_order_acquire);
+      tsc_base = _tsc.tsc_base.load(std::memory_order_relaxed);
+      ns_base = _tsc.ns_base.load(std::memory_order_relaxed);
+      ns_per_tick = _tsc.ns_per_tick.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != _tsc.seq.load(std::memory_order_relaxed));
+    auto ns = ns_base + static_cast<std::int64_t>(
+                            static_cast<double>(ticks - tsc_base) * ns_per_tick);
+    return std_time_t(std::chrono::duration_cast<std_clock::duration>(
+        std::chrono::nanoseconds(ns)));
+  }
+
+  /// Starts the calibration thread once per process.
+  static void start_calibration();
+
+  /// The source to read.
+  ClockSource _source;
+  /// Wall time minus steady time when the Clock was created.
+  std_clock::duration _steady_offset{};
+};
+
+inline Clock::TscCalibration Clock::_tsc;
+
+} // namespace Spektral::Log
@@ -0,0 +1,142 @@
+/// @file: include/Compressor.hpp
+/// @brief: the compression stage of the FileLogger backend.
+///
+/// 1. defines the Compression enum.
+/// 2. provides class Compressor, which compresses formatted batches into
+/// frames on its own thread and writes them to a sink.
+
+#pragma once
+#include "Sinks.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Spektral::Log {
+
+/**
+ * @enum Compression
+ * @brief Defines how FileLogger compresses what it writes.
+ *
+ * - NONE: Batches are written as they are formatted.
+ * - ZSTD: zstd frames. Needs libzstd.
+ * - LZ4: LZ4 frames. Needs liblz4. Faster, compresses less.
+ *
+ * A frame spans batches until it holds FileOptions::compression_frame_bytes of
+ * them: each batch is compressed against the ones before it in the frame and
+ * flushed as one or more blocks, so small batches cost a few bytes of block
+ * header rather than a frame of their own. Frames are concatenated, which
+ * the stock tools decompress as one stream (`zstd -dc`, `lz4 -dc`). Each
+ * frame is independent and ends with a checksum, so a file can be
+ * decompressed from any frame on. The last frame of a live or crashed file
+ * has no end yet: a streaming decoder still reads every batch written to it,
+ * then reports the truncation.
+ */
+enum class Compression : char {
+  NONE = 0, ///< No compression
+  ZSTD = 1, ///< zstd frames
+  LZ4 = 2   ///< LZ4 frames
+};
+
+/**
+ * @class Compressor
+ * @brief Compresses batches and writes them to a sink on a thread of its own,
+ * so that the backend formats the next batch meanwhile.
+ *
+ * The backend hands a batch over with submit(), which swaps it for the
+ * buffer of the previous one: two buffers are in use, and neither the backend
+ * nor the compression thread allocates once they have grown. submit() waits
+ * for the previous batch to be written, so at most one batch is in flight.
+ * end_frame() closes the current frame, e.g. before the file is rotated.
+ */
+class Compressor {
+public:
+  /// Whether the library was built with codec.
+  static bool available(Compression codec) noexcept;
+
+  /**
+   * @brief Starts the compression thread.
+   *
+   * @param codec ZSTD or LZ4.
+   * @param level The compression level, as the codec's command line tool
+   * takes it: 1 (fastest) to 19 for zstd, 1 to 12 for LZ4 (3 and up use
+   * LZ4 HC).
+   * @param frame_bytes How many bytes of batches a frame holds before it is
+   * ended.
+   *
+   * @throws std::invalid_argument If codec is not available().
+   */
+  Compressor(Compression codec, int level, std::size_t frame_bytes);
+
+  Compressor(const Compressor &) = delete;
+  Compressor &operator=(const Compressor &) = delete;
+
+  /// Writes the batch in flight, ends its frame and stops the thread.
+  ~Compressor();
+
+  /**
+   * @brief Hands batch over to be compressed into the current frame, flushed
+   * and written to sink. Waits until the previous batch has been written.
+   *
+   * @param batch The formatted batch; swapped for a cleared buffer.
+   * @param sink Where the blocks go. Must stay valid until the next wait(),
+   * end_frame() or submit() returns, and be the sink of the whole frame.
+   */
+  void submit(std::string &batch, ISink &sink);
+
+  /// Waits until the batch in flight, if any, has been written.
+  void wait();
+
+  /// Waits for the batch in flight and writes the end of the current frame,
+  /// if one is open, to the sink of its batches. The next batch starts a new
+  /// frame, e.g. in another sink.
+  void end_frame();
+
+  /// The number of bytes written to the sinks so far.
+  std::uint64_t written() const noexcept {
+    return _written.load(std::memory_order_relaxed);
+  }
+
+private:
+  /// What the compression thread is asked to do.
+  enum State : std::uint32_t { IDLE, BUSY, STOP };
+
+  /// The compression thread's loop.
+  void run();
+  /// Compresses _input into _frame as the next blocks of the current frame
+  /// (starting one if needed) and flushes them; also ends the frame if _end
+  /// is set or the frame is full. Returns the number of bytes to write, 0 on
+  /// error, after which the next batch starts a new frame.
+  std::size_t compress();
+
+  /// The codec.
+  const Compression _codec;
+  /// The compression level.
+  const int _level;
+  /// How many bytes of batches a frame holds before it is ended.
+  const std::size_t _frame_bytes;
+  /// How many bytes of batches the current frame holds.
+  std::size_t _frame_in = 0;
+  /// Whether a frame was started and not ended yet.
+  bool _frame_open = false;
+  /// Whether the job in flight ends the frame.
+  bool _end = false;
+  /// The codec's reusable context, if it has one.
+  void *_ctx = nullptr;
+  /// The batch in flight.
+  std::string _input;
+  /// The compressed blocks of the batch in flight.
+  std::vector<char> _frame;
+  /// Where the batch in flight goes.
+  ISink *_sink = nullptr;
+  /// The total size of the frames written.
+  std::atomic<std::uint64_t> _written{0};
+  /// IDLE, BUSY while a batch is in flight, STOP once the thread should exit.
+  std::atomic<std::uint32_t> _state{IDLE};
+  /// The compression thread; declared last so that it starts after, and
+  /// stops before, everything it uses.
+  std::jthread _thread;
+};
+
+} // namespace Spektral::Log
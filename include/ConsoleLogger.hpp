@@ -1,9 +1,15 @@
 /// @file ConsoleLogger.hpp
 
 #pragma once
+#include "Clock.hpp"
+#include "Encoders.hpp"
 #include "LogEvent.hpp"
+#include "Overflow.hpp"
+#include "Sinks.hpp"
+#include "WaitStrategy.hpp"
 #include <atomic>
-#include <deque>
+#include <cstddef>
+#include <cstdint>
 #include <future>
 
 namespace Spektral::Log {
@@ -17,21 +23,65 @@ public:
    * necessary. The default minimum log level is set to WARN, but this can be
    * overridden by providing a different LogLevel in the argument.
    *
+   * Thread-safe: the instance is a function-local static, so when several
+   * threads call get_inst() first at once exactly one creates it and the
+   * others wait for it. Later calls only check a guard variable and ignore
+   * their arguments. The instance is destroyed at exit, after writing what is
+   * pending; do not log to it from destructors of objects with static storage
+   * duration created before it.
+   *
    * @param min_level The minimum LogLevel for messages to be logged. Default:
    * WARN.
+   * @param wait What the background thread does while there is nothing to
+   * log. Only used when the instance is created. Default: WaitStrategy::PARK.
+   * @param clock Where emplace() takes its timestamps from. Only used when
+   * the instance is created. Default: ClockSource::SYSTEM.
+   * @param overflow What insert() does when the calling thread's queue is
+   * full. Only used when the instance is created. DROP_BELOW_LEVEL keeps
+   * ERROR events. Default: OverflowPolicy::THROW.
+   * @param format How events are written. Only used when the instance is
+   * created. Default: OutputFormat::TEXT.
    * @return A reference to the ConsoleLogger singleton instance.
    */
-  static ConsoleLogger &get_inst(LogLevel min_level = LogLevel::WARN);
+  static ConsoleLogger &get_inst(LogLevel min_level = LogLevel::WARN,
+                                 WaitStrategy wait = WaitStrategy::PARK,
+                                 ClockSource clock = ClockSource::SYSTEM,
+                                 OverflowPolicy overflow =
+                                     OverflowPolicy::THROW,
+                                 OutputFormat format = OutputFormat::TEXT);
   /**
    * @brief Insert a log event into the logger's queue.
    *
-   * Inserts a new LogEvent into either _stdout_log or _stderr_log based on
-   * the severity of the message and the current minimum logging level.
+   * Drops the event if it is below the minimum logging level, otherwise
+   * stamps it with the next sequence number and queues it. ERROR events (and
+   * unknown levels) are written to standard error, the others to standard
+   * output, in sequence order.
    *
    * @param l A move-only reference to LogEvent that will be moved into the
    * internal queue.
+   *
+   * @throw full_queue_exception If LOG_LANE_SZ events from the calling thread
+   * are already pending and the overflow policy is THROW.
    */
   void insert(LogEvent &&l);
+  /**
+   * @brief Builds a LogEvent stamped with the logger's clock and inserts it.
+   *
+   * Events below the minimum level are dropped before the clock is read.
+   *
+   * @param level The severity level of the event.
+   * @param source The source of the event, passed as to LogEvent::LogEvent.
+   * @param message The message of the event, passed as to LogEvent::LogEvent.
+   *
+   * @throw full_queue_exception If LOG_LANE_SZ events from the calling thread
+   * are already pending and the overflow policy is THROW.
+   */
+  void emplace(LogLevel level, Payload<ISource> source,
+               Payload<IMessage> message);
+  /// The number of events dropped because of the overflow policy.
+  std::uint64_t dropped() const noexcept {
+    return _log.dropped();
+  }
   /**
    * @brief Destructor for ConsoleLogger.
    *
@@ -41,17 +91,10 @@ public:
   ~ConsoleLogger();
 
 private:
-  /// Type alias for a deque of shared pointers to LogEvents to make
-  /// implementations easier
-  using log_t = std::deque<std::shared_ptr<LogEvent>>;
+  /// Type alias for per-thread SPSC lanes of LogEvents, stored by value, so
+  /// insert() may be called from any number of threads without contention.
+  using log_t = OverflowQueue;
 
-  /**
-   * @brief Singleton instance pointer.
-   *
-   * A static pointer to the singleton instance of ConsoleLogger. This is used
-   * internally by get_inst() to ensure thread-safe lazy initialization.
-   */
-  static ConsoleLogger *inst;
   /**
    * @brief Private constructor for ConsoleLogger.
    *
@@ -59,13 +102,41 @@ private:
    * The default minimum log level is WARN.
    *
    * @param min_level The minimum LogLevel to use. Default: WARN.
+   * @param wait The WaitStrategy of the background thread. Default: PARK.
+   * @param clock The ClockSource of emplace(). Default: SYSTEM.
+   * @param overflow The OverflowPolicy of the queue. Default: THROW.
+   * @param format The OutputFormat of both streams. Default: TEXT.
    */
   using enum LogLevel;
-  ConsoleLogger(LogLevel min_level = WARN);
-  /// Queue of LogEvents intended for standard output
-  log_t _stdout_log;
-  /// Queue of LogEvents intended for standard error
-  log_t _stderr_log;
+  ConsoleLogger(LogLevel min_level = WARN,
+                WaitStrategy wait = WaitStrategy::PARK,
+                ClockSource clock = ClockSource::SYSTEM,
+                OverflowPolicy overflow = OverflowPolicy::THROW,
+                OutputFormat format = OutputFormat::TEXT);
+  /**
+   * @brief Queue of the LogEvents of both streams.
+   *
+   * One queue rather than one per stream, so that the backend can write the
+   * events in the order they were inserted, whichever stream they go to: a
+   * terminal showing both streams shows an ERROR between the INFO lines
+   * logged before and after it. The order is exact unless a thread is
+   * preempted between stamping its event and queueing it, in which case the
+   * event may go out after later ones.
+   */
+  log_t _log;
+  /// The sequence number of the next event inserted, the one cache line
+  /// insert() shares between threads. Wraps around; events drained together
+  /// are never 2^31 apart.
+  alignas(cache_line_sz) std::atomic<std::uint32_t> _seq{0};
+  /// Writes to standard output (fd 1) with write(2), bypassing std::cout:
+  /// log lines are not ordered with the program's own iostream output, which
+  /// should be flushed first where that matters.
+  FdSink _stdout_sink;
+  /// Writes to standard error (fd 2) with write(2), bypassing std::cerr.
+  FdSink _stderr_sink;
+  /// The size the backend lets the standard output buffer grow to while it
+  /// still has events to drain.
+  static constexpr std::size_t batch_bytes = 1 << 16;
 
 private:
   /**
@@ -76,6 +147,8 @@ private:
    * stopped.
    */
   std::atomic<bool> _can_continue;
+  /// Parks the background thread while the queue is empty.
+  Waiter _waiter;
   /**
    * @brief Procedure to start the async log.
    *
@@ -93,6 +166,10 @@ private:
   std::future<void> _ref;
   /// Minimum LogLevel at which messages will be recorded
   LogLevel _min_level;
+  /// Timestamps the events built by emplace().
+  const Clock _clock;
+  /// How events are written.
+  const OutputFormat _format;
 };
 
 }; // namespace Spektral::Log
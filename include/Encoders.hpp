@@ -0,0 +1,203 @@
+/// @file: include/Encoders.hpp
+/// @brief: writes LogEvents as text, JSON lines or logfmt.
+///
+/// 1. defines the OutputFormat enum.
+/// 2. provides escape_json(), append_logfmt() and escape_text(), which escape a
+/// string into an output buffer, and set_scan_width(), which caps how wide
+/// they scan.
+/// 3. provides class Encoder, which the backends write their events with.
+
+#pragma once
+#include "LogEvent.hpp"
+#include "TimestampFormatter.hpp"
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <format>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace Spektral::Log {
+
+/**
+ * @enum OutputFormat
+ * @brief Defines how a backend writes its events.
+ *
+ * - TEXT: "INFO: <time> <message> from <source>", see LogEvent::format_to().
+ *   A source or message with a newline spans several lines.
+ * - ESCAPED_TEXT: TEXT with the control characters of sources and messages
+ *   escaped (see escape_text()), so every event is exactly one line. Costs a
+ *   scan of each record when it holds none.
+ * - JSON: A JSON object per line:
+ *   {"ts":"<time>","level":"INFO","source":"<source>","msg":"<message>",...}.
+ *   An EPOCH_NS timestamp is a number.
+ * - LOGFMT: ts=<time> level=INFO source=<source> msg=<message> ..., values
+ *   quoted when they contain a space, '=', '"' or a control character.
+ *
+ * The fields of a StructuredMessage follow "msg" in both structured formats.
+ */
+enum class OutputFormat : char {
+  TEXT = 0,        ///< Human readable lines
+  JSON = 1,        ///< JSON lines
+  LOGFMT = 2,      ///< key=value pairs
+  ESCAPED_TEXT = 3 ///< Human readable lines, one per event
+};
+
+/**
+ * @brief Appends str to out, escaped as the contents of a JSON string: '"',
+ * '\\' and control characters are escaped, everything else, UTF-8 included,
+ * is copied as is. The surrounding quotes are not written.
+ *
+ * The string is scanned 32 bytes at a time with AVX2 when the CPU has it, 16
+ * with SSE2 otherwise (bytes on other architectures), and the runs between
+ * the bytes that need escaping are copied in one piece.
+ */
+void escape_json(std::string &out, std::string_view str);
+
+/**
+ * @brief Appends str to out as a logfmt value: as is, or quoted and escaped
+ * like a JSON string when it is empty or contains a space, '=', '"', '\\' or a
+ * control character.
+ */
+void append_logfmt(std::string &out, std::string_view str);
+
+/**
+ * @brief Appends str to out with its control characters (below 0x20, and
+ * 0x7f) escaped: "\n", "\r", "\t" or "\xNN". Backslashes and everything
+ * else are copied as is, so the result is readable rather than reversible.
+ * Scanned like escape_json().
+ */
+void escape_text(std::string &out, std::string_view str);
+
+/**
+ * @enum ScanWidth
+ * @brief The widest blocks escape_json(), append_logfmt() and escape_text()
+ * scan, see set_scan_width().
+ */
+enum class ScanWidth : char {
+  AVX2 = 0,  ///< 32 bytes when the CPU has AVX2, as SSE2 otherwise (default)
+  SSE2 = 1,  ///< 16 bytes, as BYTES on other architectures
+  BYTES = 2, ///< One byte at a time
+};
+
+/**
+ * @brief Caps the scans of escape_json(), append_logfmt() and escape_text()
+ * at width, e.g. to compare them: every width escapes a string the same way.
+ * Thread-safe; applies to the calls made afterwards.
+ */
+void set_scan_width(ScanWidth width) noexcept;
+
+/**
+ * @class Encoder
+ * @brief Writes LogEvents to a buffer in an OutputFormat.
+ *
+ * A backend keeps one Encoder, which owns its TimestampFormatter, and calls
+ * encode() for every event. The structured formats write LogEvent::time,
+ * level and source as the "ts", "level" and "source" fields, then let the
+ * message write its own through IMessage::encode_to(), which calls field().
+ * Built-in message types are written as "msg".
+ */
+class Encoder {
+public:
+  /**
+   * @brief Constructs an encoder.
+   *
+   * @param format The OutputFormat. Default: TEXT.
+   * @param timestamp How timestamps are written. Default: DEFAULT.
+   * @param precision The digits of timestamps' fractions. Default: NANOS.
+   */
+  explicit Encoder(OutputFormat format = OutputFormat::TEXT,
+                   TimestampFormat timestamp = TimestampFormat::DEFAULT,
+                   TimestampPrecision precision = TimestampPrecision::NANOS)
+      : _format(format), _timestamp(timestamp), _ts(timestamp, precision) {}
+
+  /**
+   * @brief Appends event to out, terminated by a newline.
+   *
+   * @param out The buffer to append to.
+   * @param event The event. Not modified, but its message's format_to() and
+   * encode_to() are not const.
+   */
+  void encode(std::string &out, LogEvent &event);
+
+  /**
+   * @brief Writes a field of the record being encoded. Only valid inside
+   * IMessage::encode_to().
+   *
+   * @param key The name of the field, written as is: it must not need
+   * escaping.
+   * @param value The value, see append_value(). Messages take the overload
+   * below.
+   */
+  template <typename T>
+    requires(!std::derived_from<T, IMessage>)
+  void field(std::string_view key, const T &value) {
+    this->key(key);
+    append_value(*_out, value, _format);
+  }
+
+  /**
+   * @brief Writes a message's text, from its format_to(), as a field.
+   *
+   * @param key The name of the field, written as is.
+   * @param message The message.
+   */
+  void field(std::string_view key, IMessage &message);
+
+  /**
+   * @brief Appends a value in format: a string, a C string or a
+   * std::string_view as a string, an arithmetic type or a bool as a number or
+   * a bool (non-finite numbers as null in JSON), anything else formattable
+   * with std::format as the string std::format("{}") returns.
+   *
+   * @param out The buffer to append to.
+   * @param value The value.
+   * @param format LOGFMT or JSON; TEXT writes strings as is.
+   */
+  template <typename T>
+  static void append_value(std::string &out, const T &value,
+                           OutputFormat format) {
+    if constexpr (std::same_as<T, bool>) {
+      out += value ? "true" : "false";
+    } else if constexpr (std::same_as<T, char>) {
+      append_string(out, std::string_view(&value, 1), format);
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      if constexpr (std::floating_point<T>) {
+        if (format == OutputFormat::JSON && !std::isfinite(value)) {
+          out += "null";
+          return;
+        }
+      }
+      char buf[32];
+      auto res = std::to_chars(buf, buf + sizeof(buf), value);
+      out.append(buf, res.ptr);
+    } else if constexpr (std::convertible_to<const T &, std::string_view>) {
+      append_string(out, value, format);
+    } else {
+      append_string(out, std::format("{}", value), format);
+    }
+  }
+
+private:
+  /// Appends a string value: quoted and escaped in JSON, see append_logfmt()
+  /// in LOGFMT, as is in TEXT.
+  static void append_string(std::string &out, std::string_view str,
+                            OutputFormat format);
+
+  /// Starts a field: ,"key": or key=.
+  void key(std::string_view key);
+
+  /// The format of the records.
+  const OutputFormat _format;
+  /// How timestamps are written, which decides whether they need quotes.
+  const TimestampFormat _timestamp;
+  /// Writes the timestamps.
+  TimestampFormatter _ts;
+  /// The buffer of the record being encoded.
+  std::string *_out = nullptr;
+  /// Holds sources and messages formatted before they are escaped.
+  std::string _scratch;
+};
+
+} // namespace Spektral::Log
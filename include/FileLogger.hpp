@@ -1,13 +1,121 @@
 #pragma once
+#include "Clock.hpp"
+#include "Compressor.hpp"
+#include "Encoders.hpp"
 #include "LogEvent.hpp"
-#include <deque>
-#include <fstream>
+#include "Overflow.hpp"
+#include "Rotator.hpp"
+#include "Sinks.hpp"
+#include "TimestampFormatter.hpp"
+#include "WaitStrategy.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <future>
 #include <atomic>
 #include <memory>
+#include <string>
 
 namespace Spektral::Log {
 
+/**
+ * @enum FlushPolicy
+ * @brief Defines when the FileLogger backend hands its batch buffer to the
+ * kernel while it is busy. An idle backend always writes what it holds before
+ * it waits.
+ *
+ * - EVERY_BATCH: After every drained batch.
+ * - INTERVAL: Once FileOptions::flush_interval has passed since the last
+ *   write.
+ * - ON_ERROR: As soon as the batch contains an ERROR event.
+ *
+ * Whatever the policy, the buffer is written once it holds
+ * FileOptions::batch_bytes.
+ */
+enum class FlushPolicy : char {
+  EVERY_BATCH = 0, ///< Write after every batch
+  INTERVAL = 1,    ///< Write every flush_interval
+  ON_ERROR = 2     ///< Write when an ERROR is logged
+};
+
+/**
+ * @enum FileBackend
+ * @brief Defines how the FileLogger backend hands batches to the kernel.
+ *
+ * - WRITE: Synchronous write(2) (FdSink).
+ * - IO_URING: Asynchronous writes through io_uring (IoUringSink). Falls back
+ *   to WRITE when io_uring is unavailable.
+ * - MMAP: memcpy into preallocated, memory-mapped segments (MmapSink).
+ */
+enum class FileBackend : char {
+  WRITE = 0,    ///< write(2) from the backend thread
+  IO_URING = 1, ///< io_uring with registered buffers and fd
+  MMAP = 2      ///< memcpy into mmap()ed segments
+};
+
+/**
+ * @struct FileOptions
+ * @brief Tuning knobs for a FileLogger.
+ */
+struct FileOptions {
+  /// What the background thread does while there is nothing to log.
+  WaitStrategy wait = WaitStrategy::PARK;
+  /// The maximum number of events taken from one thread's lane per batch.
+  std::size_t batch_events = 1024;
+  /// The size of the reusable batch buffer; reaching it forces a write.
+  std::size_t batch_bytes = 1 << 16;
+  /// When a busy backend writes its batch buffer.
+  FlushPolicy flush = FlushPolicy::EVERY_BATCH;
+  /// The period used by FlushPolicy::INTERVAL.
+  std::chrono::milliseconds flush_interval{100};
+  /// How batches are written to the file.
+  FileBackend backend = FileBackend::WRITE;
+  /// The number of in-flight staging buffers used by FileBackend::IO_URING.
+  unsigned uring_buffers = 3;
+  /// The size of each segment used by FileBackend::MMAP.
+  std::size_t segment_bytes = 64 << 20;
+  /// When FileBackend::MMAP msync()s what it wrote.
+  MsyncPolicy msync = MsyncPolicy::ON_ROLL;
+  /// Where emplace() takes its timestamps from.
+  ClockSource clock = ClockSource::SYSTEM;
+  /// How timestamps are written.
+  TimestampFormat timestamp = TimestampFormat::DEFAULT;
+  /// How many fractional digits of the second are written.
+  TimestampPrecision timestamp_precision = TimestampPrecision::NANOS;
+  /// How events are written: text, JSON lines or logfmt.
+  OutputFormat format = OutputFormat::TEXT;
+  /// What insert() does when the calling thread's queue is full.
+  OverflowPolicy overflow = OverflowPolicy::THROW;
+  /// The lowest LogLevel OverflowPolicy::DROP_BELOW_LEVEL keeps.
+  LogLevel overflow_level = LogLevel::ERROR;
+  /// The capacity of each thread's lane, in events. Must be a power of two.
+  /// Memory grows with it times the number of threads that log.
+  std::size_t lane_events = LOG_LANE_SZ;
+  /// Rotate once the file holds this many bytes. 0: never. With rotation
+  /// enabled an existing file is appended to rather than truncated, and
+  /// counts towards this.
+  std::size_t rotate_bytes = 0;
+  /// Rotate once the file has been written to for this long, even while the
+  /// logger is idle. An empty file is not rotated. 0: never.
+  std::chrono::seconds rotate_interval{0};
+  /// Whether FileLogger::rotate() may be called. Implied by rotate_bytes and
+  /// rotate_interval.
+  bool rotate_on_request = false;
+  /// How many rotated files are kept, the oldest are deleted. 0: all.
+  unsigned retain = 0;
+  /// Whether rotated files are gzip-compressed. Ignored when compression is
+  /// set: the files are compressed already.
+  bool compress = false;
+  /// How batches are compressed before they are written, on a thread of
+  /// their own. The file is then a sequence of independent frames.
+  Compression compression = Compression::NONE;
+  /// The level compression uses, see Compressor::Compressor().
+  int compression_level = 1;
+  /// How many bytes of batches a compressed frame holds before the next one
+  /// starts, see Compression. Rotation ends the frame too.
+  std::size_t compression_frame_bytes = 1 << 20;
+};
+
 /**
  * @brief A class for logging events to a file.
  *
@@ -19,17 +127,24 @@ class FileLogger {
 public:
   /**
    * @brief Type alias for the log queue.
+   *
+   * Every thread calling insert() gets its own SPSC lane of
+   * FileOptions::lane_events events, so producers never contend with each
+   * other. Events are stored by value.
+   * A full lane is handled according to FileOptions::overflow.
    */
-  using log_t = std::deque<std::shared_ptr<LogEvent>>;
+  using log_t = OverflowQueue;
 
   /**
    * @brief Constructor that takes a file path to which logs will be written.
    *
    * @param file_path The file path to the file to log to.
+   * @param wait What the background thread does while there is nothing to
+   * log. Default: WaitStrategy::PARK.
    *
-   * The constructor initializes an output stream used to write the log events.
-   * This stream is used by a background thread to write the queued log events
-   * to the specified file.
+   * The constructor opens (and truncates) the file. A background thread
+   * formats the queued log events into a batch buffer and writes it to the
+   * file with a single write(2) per batch.
    *
    * @throws std::runtime_error If the file cannot be opened.
    *
@@ -38,7 +153,31 @@ public:
    * Logger("logs/network.log");
    * @endcode
    */
-  explicit FileLogger(const std::string &file_path);
+  explicit FileLogger(const std::string &file_path,
+                      WaitStrategy wait = WaitStrategy::PARK);
+
+  /**
+   * @brief Constructor that takes a file path and batching options.
+   *
+   * @param file_path The file path to the file to log to.
+   * @param opts How the background thread waits, batches, flushes and
+   * rotates.
+   *
+   * The file is truncated, unless rotation is enabled: then it is appended
+   * to, so that restarting keeps what the previous run had not rotated yet.
+   *
+   * @throws std::runtime_error If the file cannot be opened.
+   * @throws std::invalid_argument If rotation is enabled with
+   * FileBackend::MMAP, whose segments already split the file, or if the
+   * library was built without FileOptions::compression. The file is left
+   * untouched then.
+   *
+   * Example:
+   * @code
+   * FileLogger("logs/network.log", {.flush = FlushPolicy::ON_ERROR});
+   * @endcode
+   */
+  FileLogger(const std::string &file_path, const FileOptions &opts);
 
   /**
    * @brief Destructor.
@@ -61,12 +200,53 @@ public:
    *
    * @note The inserted event is moved, i.e., it is no longer accessible in
    * its original location after this function call.
+   *
+   * @throw full_queue_exception If FileOptions::lane_events events from the
+   * calling thread are already pending and FileOptions::overflow is THROW.
    */
   void insert(LogEvent &&event);
 
+  /**
+   * @brief Builds a LogEvent stamped with this logger's clock
+   * (FileOptions::clock) and inserts it.
+   *
+   * @param level The severity level of the event.
+   * @param source The source of the event, passed as to LogEvent::LogEvent.
+   * @param message The message of the event, passed as to LogEvent::LogEvent.
+   *
+   * @throw full_queue_exception If FileOptions::lane_events events from the
+   * calling thread are already pending and FileOptions::overflow is THROW.
+   */
+  void emplace(LogLevel level, Payload<ISource> source,
+               Payload<IMessage> message);
+
+  /// The number of events dropped because of FileOptions::overflow.
+  std::uint64_t dropped() const noexcept { return _log_queue.dropped(); }
+
+  /**
+   * @brief Asks the backend to rotate the file before its next batch, e.g.
+   * from a SIGHUP handler's thread. Returns right away.
+   *
+   * The file is renamed to "<path>.N", where N counts up from the highest one
+   * already present, and logging continues in a new file at the same path.
+   * The new file is opened ahead of time and the rotated one renamed,
+   * compressed (FileOptions::compress) and pruned (FileOptions::retain) on a
+   * helper thread, so neither insert() nor the backend wait for the disk.
+   *
+   * @throws std::logic_error If rotation is not enabled, see
+   * FileOptions::rotate_on_request.
+   */
+  void rotate();
+
 private:
-  /// The output stream where log events are written to.
-  std::shared_ptr<std::ofstream> _sink;
+  /// The options this logger was built with.
+  const FileOptions _opts;
+
+  /// Timestamps the events built by emplace().
+  const Clock _clock;
+
+  /// Where formatted batches are written to.
+  std::unique_ptr<ISink> _sink;
 
   /// Queue storing log events.
   log_t _log_queue;
@@ -74,6 +254,19 @@ private:
   /// Atomic flag to control the background thread.
   std::atomic<bool> _can_continue;
 
+  /// Parks the background thread while the queue is empty.
+  Waiter _waiter;
+
+  /// Prepares and disposes of files when rotation is enabled, nullptr
+  /// otherwise.
+  std::unique_ptr<Rotator> _rotator;
+
+  /// Set by rotate(), cleared by the backend once it has rotated.
+  std::atomic<bool> _rotate_requested{false};
+
+  /// What the file held when it was opened: a rotated file is appended to.
+  std::size_t _initial_bytes = 0;
+
   /**
    * @brief Starts the background logging thread.
    *
@@ -83,7 +276,9 @@ private:
    *         terminate.
    *
    * This function creates and starts a background thread that continuously
-   * monitors the log queue and writes events to the output stream.
+   * drains every thread's lane of the log queue, orders each drained batch by
+   * LogEvent::time, formats it into a reusable buffer and writes the buffer
+   * according to FileOptions::flush.
    */
   [[nodiscard("Return is the value to stop the thread. Do not discard.")]]
   std::future<void> start_backend(std::atomic<bool> &can_continue);
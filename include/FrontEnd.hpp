@@ -1,16 +1,228 @@
 /// @file: include/FrontEnd.hpp
 /// @brief: This file provides an API for Spektral::Log.
+///
+/// 1. defines LOG_ACTIVE_LEVEL and LOG_STRIP_DEBUG, which remove log calls at
+/// compile time.
+/// 2. provides class FrontEnd, the process-wide logger created by make_log()
+/// and returned by get_log(), which routes events to the console and a file.
+/// 3. provides the SPEKTRAL_LOG, SPEKTRAL_INFO, SPEKTRAL_WARN, SPEKTRAL_DEBUG
+/// and SPEKTRAL_ERROR macros, which do not evaluate their arguments unless the
+/// event is logged.
 #pragma once
 static_assert(__cplusplus >= 202002L,
               "Spektral::Log requires C++20 at minimum");
 
-// TODO: remove when I implement
-static_assert(false, "Do not use frontend API yet.");
+#include "ConsoleLogger.hpp"
+#include "FileLogger.hpp"
+#include "LogEvent.hpp"
+#include "Messages.hpp"
+#include "Router.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
 
-// TODO: 1.
+#ifndef LOG_ACTIVE_LEVEL
+/**
+ * @brief The lowest LogLevel, as an integer, whose log calls are compiled in.
+ *
+ * SPEKTRAL_LOG calls below it compile to nothing. Default: 0 (INFO, i.e.
+ * everything). Can be overridden at compile time, e.g. -DLOG_ACTIVE_LEVEL=1
+ * to remove INFO calls.
+ */
+#define LOG_ACTIVE_LEVEL 0
+#endif
+
+#ifndef LOG_STRIP_DEBUG
+/**
+ * @brief Whether SPEKTRAL_DEBUG calls compile to nothing.
+ *
+ * DEBUG sorts above WARN, so LOG_ACTIVE_LEVEL alone cannot remove it. Default:
+ * 1 when NDEBUG is defined, 0 otherwise.
+ */
+#ifdef NDEBUG
+#define LOG_STRIP_DEBUG 1
+#else
+#define LOG_STRIP_DEBUG 0
+#endif
+#endif
 
 namespace Spektral::Log {
-struct LOGGER_STATE {};
-void make_log();
-LOGGER_STATE get_log();
+
+/**
+ * @brief Whether log calls at level are compiled in, see LOG_ACTIVE_LEVEL and
+ * LOG_STRIP_DEBUG.
+ */
+constexpr bool compiled_in(LogLevel level) {
+  return static_cast<int>(level) >= LOG_ACTIVE_LEVEL &&
+         !(LOG_STRIP_DEBUG && level == LogLevel::DEBUG);
+}
+
+/**
+ * @struct LogOptions
+ * @brief How make_log() sets up the process-wide logger.
+ */
+struct LogOptions {
+  /// The minimum LogLevel logged at all, can be changed with
+  /// FrontEnd::set_level().
+  LogLevel min_level = LogLevel::WARN;
+  /// Where events are stamped.
+  ClockSource clock = ClockSource::SYSTEM;
+  /// Whether to log to the console.
+  bool console = true;
+  /// The minimum LogLevel sent to the console.
+  LogLevel console_level = LogLevel::INFO;
+  /// What the ConsoleLogger's background thread does while idle, when it is
+  /// created by make_log(). An existing ConsoleLogger keeps its settings,
+  /// minimum level included.
+  WaitStrategy console_wait = WaitStrategy::PARK;
+  /// What the ConsoleLogger does when a queue is full, when it is created by
+  /// make_log(). The file's is FileOptions::overflow.
+  OverflowPolicy console_overflow = OverflowPolicy::THROW;
+  /// How the ConsoleLogger writes events, when it is created by make_log().
+  /// The file's is FileOptions::format.
+  OutputFormat console_format = OutputFormat::TEXT;
+  /// A file to log to as well. Empty: none.
+  std::string file_path;
+  /// The minimum LogLevel sent to the file.
+  LogLevel file_level = LogLevel::INFO;
+  /// The options of the FileLogger, when file_path is set.
+  FileOptions file{};
+};
+
+/**
+ * @class FrontEnd
+ * @brief The process-wide logger behind the SPEKTRAL_LOG macros.
+ *
+ * Created by make_log() (or by the first get_log() with default options) and
+ * alive until the end of the program, when it writes whatever is pending.
+ */
+class FrontEnd {
+public:
+  /**
+   * @brief Whether an event at level would be logged.
+   *
+   * One relaxed load; the macros call it before evaluating any argument.
+   */
+  bool enabled(LogLevel level) const noexcept {
+    return compiled_in(level) &&
+           level >= _min_level.load(std::memory_order_relaxed) &&
+           _router.enabled(level);
+  }
+
+  /// Changes the minimum LogLevel logged. Thread-safe.
+  void set_level(LogLevel level) noexcept {
+    _min_level.store(level, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Logs an event to the console and/or the file, depending on their
+   * levels. The event is stamped once and its payloads are shared.
+   *
+   * Does not check enabled(); the macros do.
+   *
+   * @param level The severity level of the event.
+   * @param source The source of the event, see LogEvent::LogEvent.
+   * @param message The message of the event, see LogEvent::LogEvent.
+   *
+   * A logger whose queue is full applies its OverflowPolicy; with THROW the
+   * event is dropped and counted by router().
+   */
+  void log(LogLevel level, Payload<ISource> source, Payload<IMessage> message) {
+    _router.log(level, std::move(source), std::move(message));
+  }
+
+  /// The router behind log(), e.g. for Router::dropped(): route 0 is the
+  /// console when LogOptions::console is set, the file comes next.
+  const Router &router() const noexcept { return _router; }
+
+  ~FrontEnd();
+
+private:
+  friend FrontEnd &make_log(const LogOptions &opts);
+  friend FrontEnd &get_log();
+  explicit FrontEnd(const LogOptions &opts);
+
+  /// The minimum LogLevel logged.
+  std::atomic<LogLevel> _min_level;
+  /// The file logger, if LogOptions::file_path was set.
+  std::unique_ptr<FileLogger> _file;
+  /// Sends events to the console and _file.
+  Router _router;
+};
+
+/**
+ * @brief Creates the process-wide logger.
+ *
+ * @param opts Where and what to log.
+ * @return The logger, also returned by get_log() from now on.
+ *
+ * @throws std::logic_error If the logger already exists, e.g. because
+ * get_log() was called first.
+ * @throws std::runtime_error If the file cannot be opened.
+ */
+FrontEnd &make_log(const LogOptions &opts = {});
+
+/**
+ * @brief Returns the process-wide logger, creating it with default options
+ * (WARN and above, to the console) if make_log() was not called.
+ */
+FrontEnd &get_log();
+
+/**
+ * @brief Builds the message of a SPEKTRAL_LOG call.
+ *
+ * A format string without arguments or braces is passed as a C string, which
+ * needs no formatting; anything else becomes a FormatMessage.
+ */
+template <FixedString Fmt, typename... Args>
+Payload<IMessage> log_message(Args &&...args) {
+  if constexpr (sizeof...(Args) == 0 &&
+                Fmt.view().find_first_of("{}") == std::string_view::npos)
+    return Payload<IMessage>(Format<Fmt>::str.data());
+  else
+    return make_message<Fmt>(std::forward<Args>(args)...);
+}
+
 } // namespace Spektral::Log
+
+/**
+ * @brief Logs through get_log() with a format string literal.
+ *
+ * Compiles to nothing when level is not compiled_in(). Otherwise the message
+ * is only built, and the arguments only evaluated, when
+ * get_log().enabled(level).
+ *
+ * @param level A constant expression LogLevel.
+ * @param source The source of the event, e.g. a string literal.
+ * @param fmt A string literal std::format format string, checked at compile
+ * time.
+ * @param ... The arguments of fmt.
+ */
+#define SPEKTRAL_LOG(level, source, fmt, ...)                                  \
+  do {                                                                         \
+    if constexpr (::Spektral::Log::compiled_in(level)) {                       \
+      if (auto &spektral_log_ = ::Spektral::Log::get_log();                    \
+          spektral_log_.enabled(level))                                        \
+        spektral_log_.log(level, source,                                       \
+                          ::Spektral::Log::log_message<fmt>(__VA_ARGS__));     \
+    }                                                                          \
+  } while (0)
+
+/// SPEKTRAL_LOG at LogLevel::INFO.
+#define SPEKTRAL_INFO(source, fmt, ...)                                        \
+  SPEKTRAL_LOG(::Spektral::Log::LogLevel::INFO, source, fmt __VA_OPT__(, )     \
+                   __VA_ARGS__)
+/// SPEKTRAL_LOG at LogLevel::WARN.
+#define SPEKTRAL_WARN(source, fmt, ...)                                        \
+  SPEKTRAL_LOG(::Spektral::Log::LogLevel::WARN, source, fmt __VA_OPT__(, )     \
+                   __VA_ARGS__)
+/// SPEKTRAL_LOG at LogLevel::DEBUG.
+#define SPEKTRAL_DEBUG(source, fmt, ...)                                       \
+  SPEKTRAL_LOG(::Spektral::Log::LogLevel::DEBUG, source, fmt __VA_OPT__(, )    \
+                   __VA_ARGS__)
+/// SPEKTRAL_LOG at LogLevel::ERROR.
+#define SPEKTRAL_ERROR(source, fmt, ...)                                       \
+  SPEKTRAL_LOG(::Spektral::Log::LogLevel::ERROR, source, fmt __VA_OPT__(, )    \
+                   __VA_ARGS__)
@@ -0,0 +1,178 @@
+/// @file: include/InlinePtr.hpp
+/// @brief: an owning pointer to a polymorphic object that stores small objects
+/// inline.
+///
+/// 1. defines LOG_INLINE_SZ, the inline capacity used by LogEvent.
+/// 2. provides class InlinePtr<I, Capacity, Alloc>.
+
+#pragma once
+#include "SlabAllocator.hpp"
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef LOG_INLINE_SZ
+/**
+ * @brief Bytes a LogEvent reserves inline for its source and for its message.
+ *
+ * Sources and messages up to this size (vtable pointer included) are stored in
+ * the event itself instead of on the heap. The default fits a
+ * Source<std::string> or Message<std::string> with room to spare. Can be
+ * overridden at compile time with -DLOG_INLINE_SZ=...
+ */
+#define LOG_INLINE_SZ 48
+#endif
+
+namespace Spektral::Log {
+
+/**
+ * @class InlinePtr
+ * @brief A move-only owning pointer to an I that keeps small objects in an
+ * inline buffer.
+ *
+ * Constructed from a value of a type derived from I, the object is moved into
+ * the buffer when it fits and is nothrow move constructible, and into memory
+ * from Alloc otherwise. Constructed from a std::unique_ptr, it simply takes
+ * ownership. Either way it is used like a pointer.
+ *
+ * @tparam I The interface type. Must have a virtual destructor.
+ * @tparam Capacity The size of the inline buffer.
+ * @tparam Alloc Where objects that do not fit go: a class with static
+ * allocate(size) and deallocate(ptr, size), such as SlabAllocator or
+ * NewAllocator.
+ */
+template <typename I, std::size_t Capacity = LOG_INLINE_SZ,
+          typename Alloc = LOG_PAYLOAD_ALLOCATOR>
+class InlinePtr {
+  static_assert(std::has_virtual_destructor_v<I>);
+
+public:
+  /// Constructs an empty pointer.
+  InlinePtr() noexcept = default;
+
+  /**
+   * @brief Takes ownership of a heap allocated object.
+   *
+   * @param ptr The object. May be null.
+   */
+  template <std::derived_from<I> U>
+  InlinePtr(std::unique_ptr<U> ptr) noexcept
+      : _ptr(ptr.release()), _ops(_ptr ? &adopted_ops : nullptr) {}
+
+  /**
+   * @brief Stores a copy of val (moved if it is an rvalue), inline if it fits.
+   *
+   * @param val The object.
+   */
+  template <typename T>
+    requires std::derived_from<std::remove_cvref_t<T>, I>
+  InlinePtr(T &&val) {
+    using U = std::remove_cvref_t<T>;
+    if constexpr (fits<U>) {
+      _ptr = ::new (static_cast<void *>(_buf)) U(std::forward<T>(val));
+      _ops = &inline_ops<U>;
+    } else if constexpr (alignof(U) <= alignof(std::max_align_t)) {
+      void *mem = Alloc::allocate(sizeof(U));
+      try {
+        _ptr = ::new (mem) U(std::forward<T>(val));
+      } catch (...) {
+        Alloc::deallocate(mem, sizeof(U));
+        throw;
+      }
+      _ops = &alloc_ops<U>;
+    } else {
+      _ptr = new U(std::forward<T>(val));
+      _ops = &adopted_ops;
+    }
+  }
+
+  InlinePtr(InlinePtr &&other) noexcept { take(other); }
+
+  InlinePtr &operator=(InlinePtr &&other) noexcept {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
+    return *this;
+  }
+
+  InlinePtr(const InlinePtr &) = delete;
+  InlinePtr &operator=(const InlinePtr &) = delete;
+
+  ~InlinePtr() { reset(); }
+
+  /// Destroys the object, leaving the pointer empty.
+  void reset() noexcept {
+    if (_ops)
+      _ops->destroy(_ptr);
+    _ptr = nullptr;
+    _ops = nullptr;
+  }
+
+  /// Whether the object is stored inline (false when empty).
+  bool is_inline() const noexcept { return _ops && _ops->move; }
+
+  I *get() const noexcept { return _ptr; }
+  I *operator->() const noexcept { return _ptr; }
+  I &operator*() const noexcept { return *_ptr; }
+  explicit operator bool() const noexcept { return _ptr != nullptr; }
+  friend bool operator==(const InlinePtr &ptr, std::nullptr_t) noexcept {
+    return ptr._ptr == nullptr;
+  }
+
+private:
+  /// How to move and destroy the object, one table per stored type.
+  struct Ops {
+    /// Move constructs the object into dst's buffer and destroys the source.
+    /// nullptr for objects outside the buffer, which are moved by stealing the
+    /// pointer.
+    I *(*move)(void *dst, I *src) noexcept;
+    void (*destroy)(I *obj) noexcept;
+  };
+
+  template <typename U>
+  static constexpr bool fits =
+      sizeof(U) <= Capacity &&
+      alignof(U) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible_v<U>;
+
+  template <typename U>
+  static constexpr Ops inline_ops{
+      [](void *dst, I *src) noexcept -> I * {
+        U *obj = static_cast<U *>(src);
+        I *moved = ::new (dst) U(std::move(*obj));
+        obj->~U();
+        return moved;
+      },
+      [](I *obj) noexcept { static_cast<U *>(obj)->~U(); }};
+
+  template <typename U>
+  static constexpr Ops alloc_ops{nullptr, [](I *obj) noexcept {
+                                   U *val = static_cast<U *>(obj);
+                                   val->~U();
+                                   Alloc::deallocate(val, sizeof(U));
+                                 }};
+
+  static constexpr Ops adopted_ops{nullptr,
+                                   [](I *obj) noexcept { delete obj; }};
+
+  /// Moves other's object into this (empty) pointer and empties other.
+  void take(InlinePtr &other) noexcept {
+    _ops = other._ops;
+    _ptr = _ops && _ops->move ? _ops->move(_buf, other._ptr) : other._ptr;
+    other._ptr = nullptr;
+    other._ops = nullptr;
+  }
+
+  /// The object, either in _buf or outside of it.
+  I *_ptr = nullptr;
+  /// The operations for the stored type, nullptr when empty.
+  const Ops *_ops = nullptr;
+  /// Inline storage.
+  alignas(std::max_align_t) unsigned char _buf[Capacity];
+};
+
+} // namespace Spektral::Log
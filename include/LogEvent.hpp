@@ -4,7 +4,9 @@
  */
 
 #pragma once
+#include "Payload.hpp"
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -36,6 +38,9 @@ enum class LogLevel : char {
 using std_clock = std::chrono::system_clock;
 using std_time_t = std_clock::time_point;
 
+class Encoder;
+class TimestampFormatter;
+
 /**
  * @class ISource
  * @brief Interface for log event sources.
@@ -52,6 +57,16 @@ public:
    */
   virtual operator std::string() = 0;
 
+  /**
+   * @brief Appends the string representation of the source to out.
+   *
+   * The default implementation appends operator std::string(); override it to
+   * write into out without building a temporary string.
+   *
+   * @param out The buffer to append to.
+   */
+  virtual void format_to(std::string &out) { out += operator std::string(); }
+
   /**
    * @brief Virtual destructor.
    *
@@ -76,6 +91,26 @@ public:
    */
   virtual operator std::string() = 0;
 
+  /**
+   * @brief Appends the string representation of the message to out.
+   *
+   * The default implementation appends operator std::string(); override it to
+   * write into out without building a temporary string.
+   *
+   * @param out The buffer to append to.
+   */
+  virtual void format_to(std::string &out) { out += operator std::string(); }
+
+  /**
+   * @brief Writes the message as fields of a JSON or logfmt record.
+   *
+   * The default implementation writes format_to()'s text as the "msg" field;
+   * StructuredMessage adds its key/value fields. See Encoder.
+   *
+   * @param enc The encoder, whose field() writes each field.
+   */
+  virtual void encode_to(Encoder &enc);
+
   /**
    * @brief Virtual destructor.
    *
@@ -90,47 +125,101 @@ public:
  *
  * This structure encapsulates all the information associated with a single
  * log event, including its severity level, timestamp, source, and message.
+ *
+ * LogEvent is a value type: sources and messages passed by value are stored
+ * inline when they fit in LOG_INLINE_SZ bytes, so an event such as
+ * @code
+ * {LogLevel::INFO, Source<std::string>("main"), Message<std::string>("Hi")}
+ * @endcode
+ * needs no heap allocation at all, and the loggers move it straight into their
+ * queues. Strings, literals and numbers can be passed directly, e.g.
+ * {LogLevel::INFO, "main", 42}; they are held by Payload without a virtual
+ * interface.
  */
 struct LogEvent {
-  LogLevel level;                    ///< Severity level of the log event.
-  std_time_t time;                   ///< Timestamp of the log event.
-  std::unique_ptr<ISource> source;   ///< Source of the log event.
-  std::unique_ptr<IMessage> message; ///< Message of the log event.
+  LogLevel level;            ///< Severity level of the log event.
+  /// Insertion order, stamped by loggers that keep it (ConsoleLogger); 0
+  /// otherwise. Fits in the padding after level.
+  std::uint32_t seq = 0;
+  std_time_t time;           ///< Timestamp of the log event.
+  Payload<ISource> source;   ///< Source of the log event.
+  Payload<IMessage> message; ///< Message of the log event.
 
   /**
    * @brief Constructs a LogEvent.
    * @param level The severity level of the log event.
-   * @param source Pointer to the source of the event.  Ownership is
-   * transferred.
-   * @param message Pointer to the message of the event. Ownership is
-   * transferred.
+   * @param source The source of the event: a string, a C string (stored as
+   * is, it must outlive the event), a number, a bool, a std::unique_ptr to an
+   * ISource, whose ownership is transferred, or an object derived from
+   * ISource, which is moved into the event.
+   * @param message The message of the event, passed the same way.
+   *
+   * @throw message_nullptr_exception
+   * @throw source_nullptr_exception
    */
-  LogEvent(LogLevel level, std::unique_ptr<ISource> source,
-           std::unique_ptr<IMessage> message);
+  LogEvent(LogLevel level, Payload<ISource> source, Payload<IMessage> message);
 
   /**
-   * @brief Move constructor.
-   * @param other The LogEvent to move from.
+   * @brief Constructs a LogEvent with a timestamp taken by the caller, e.g.
+   * from a logger's Clock.
+   * @param level The severity level of the log event.
+   * @param time The timestamp of the log event.
+   * @param source The source of the event, see above.
+   * @param message The message of the event, see above.
    *
    * @throw message_nullptr_exception
    * @throw source_nullptr_exception
    */
-  LogEvent(LogEvent &&other);
+  LogEvent(LogLevel level, std_time_t time, Payload<ISource> source,
+           Payload<IMessage> message);
+
+  /**
+   * @brief Move constructor. Leaves other without a source and a message.
+   * @param other The LogEvent to move from.
+   */
+  LogEvent(LogEvent &&other) noexcept = default;
+
+  /**
+   * @brief Move assignment. Leaves other without a source and a message.
+   * @param other The LogEvent to move from.
+   */
+  LogEvent &operator=(LogEvent &&other) noexcept = default;
 
   /**
    * @brief Destructor.
    *
-   * The unique pointers `source` and `message` will automatically delete the
-   * owned objects when the `LogEvent` is destroyed.  No manual `delete` calls
-   * are necessary.
+   * `source` and `message` destroy the objects they own, inline or not.
    */
-  ~LogEvent() = default; // No user-defined logic needed thanks to unique_ptr
+  ~LogEvent() = default;
 
   /**
    * @brief Converts the log event to a string representation.
+   *
+   * The timestamp is written by a default TimestampFormatter private to the
+   * calling thread.
+   *
    * @return String representation of the log event.
    */
   operator std::string();
+
+  /**
+   * @brief Converts the log event to a string representation.
+   * @param ts Writes the timestamp.
+   * @return String representation of the log event.
+   */
+  std::string to_string(TimestampFormatter &ts);
+
+  /**
+   * @brief Appends the string representation of the log event to out.
+   *
+   * The source and message are written through their format_to(), so a
+   * backend formatting a batch into one reused buffer builds no temporary
+   * strings.
+   *
+   * @param out The buffer to append to.
+   * @param ts Writes the timestamp.
+   */
+  void format_to(std::string &out, TimestampFormatter &ts);
 };
 
 } // namespace Spektral::Log
@@ -4,9 +4,26 @@
 /// defines a string conversion operator.
 /// 2. provides class Message<T>, a encapsulation around a value of type T,
 /// which implements IMessage.
+/// 3. provides FixedString and Format<Fmt>, which turn a string literal format
+/// into a compile-time id.
+/// 4. provides class FormatMessage<Fmt, Args...>, a format string checked at
+/// compile time plus its arguments, which implements IMessage.
+/// 5. provides Field<Key, T> and class StructuredMessage<Msg, Fields...>, a
+/// message text plus typed key/value fields, which implements IMessage.
 
 #pragma once
+#include "Encoders.hpp"
 #include "LogEvent.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace Spektral::Log {
 
@@ -42,7 +59,7 @@ private:
   /**
    * @brief: val is the encapsulated value that this wrapper will hold onto.
    */
-  std::unique_ptr<T> val;
+  T val;
 
 public:
   /**
@@ -52,11 +69,10 @@ public:
    * @param args A parameter pack that will be expanded and converted into type
    * T.
    */
-  template <typename... Args> Message(Args... args) {
-    val = std::make_unique<T>(args...);
-  }
+  template <typename... Args>
+  Message(Args... args) : val(std::move(args)...) {}
 
-  operator std::string() override { return val->operator std::string(); }
+  operator std::string() override { return val.operator std::string(); }
   /**
    * @brief Creates and returns a pointer to a new Message object.
    *
@@ -80,7 +96,7 @@ public:
    */
   template <typename... Args>
   static std::unique_ptr<Message> Make(Args... args) {
-    return std::make_unique(args...);
+    return std::make_unique<Message>(std::move(args)...);
   }
 };
 
@@ -98,24 +114,27 @@ private:
   /**
    * @brief: The encapsulated value that this wrapper will hold onto.
    */
-  std::unique_ptr<std::string> val;
+  std::string val;
 
 public:
   /**
-   * @brief A copy constructor for use EXCLUSIVELY by Message<std::string>::Make;
+   * @brief A copy constructor. Pass the result to LogEvent by value to store
+   * it inline, without a heap allocation.
    *
    * @param str const std::string & The value to copy from.
    * T.
    */
-  Message(const std::string &str) { val = std::make_unique<std::string>(str); }
+  Message(const std::string &str) : val(str) {}
   /**
-   * @brief A move constructor for use EXCLUSIVELY by Message<std::string>::Make;
+   * @brief A move constructor. Pass the result to LogEvent by value to store
+   * it inline, without a heap allocation.
    *
    * @param str const std::string The value to move from.
    * T.
    */
-  Message(std::string &&str) { val = std::make_unique<std::string>(str); }
-  operator std::string() override { return *val; }
+  Message(std::string &&str) noexcept : val(std::move(str)) {}
+  operator std::string() override { return val; }
+  void format_to(std::string &out) override { out += val; }
   static std::unique_ptr<Message> Make(std::string &&value) {
     return std::make_unique<Message>(std::move(value));
   }
@@ -126,9 +145,286 @@ template <> class Message<int> : public Spektral::Log::IMessage {
 
 public:
   operator std::string() override { return std::to_string(val); }
+  void format_to(std::string &out) override {
+    char buf[16];
+    auto res = std::to_chars(buf, buf + sizeof(buf), val);
+    out.append(buf, res.ptr);
+  }
   Message(int v) { val = v; }
   static std::unique_ptr<Message> Make(int v) {
     return std::make_unique<Message>(v);
   }
 };
+
+/**
+ * @brief Computes the id of a format string (64 bit FNV-1a).
+ *
+ * The id only depends on the string, so it is the same in every process and
+ * can be computed at compile time.
+ */
+constexpr std::uint64_t format_id(std::string_view fmt) {
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  for (char c : fmt) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/**
+ * @struct FixedString
+ * @brief A string literal usable as a template argument.
+ *
+ * Lets a format string be passed as `make_message<"x = {}">(x)`. The
+ * characters live in the template parameter object, which has static storage
+ * duration, so nothing is copied at runtime.
+ *
+ * @tparam N The size of the literal, terminating null included.
+ */
+template <std::size_t N> struct FixedString {
+  /// Copies the literal at compile time.
+  consteval FixedString(const char (&str)[N]) { std::copy_n(str, N, data); }
+
+  /// The string, without the terminating null.
+  constexpr std::string_view view() const { return {data, N - 1}; }
+
+  char data[N]{};
+};
+
+/**
+ * @struct Format
+ * @brief The compile-time id and static text of a format string.
+ *
+ * @tparam Fmt The format string.
+ */
+template <FixedString Fmt> struct Format {
+  /// The id of the format string, see format_id().
+  static constexpr std::uint64_t id = format_id(Fmt.view());
+  /// The format string itself, pointing into static storage.
+  static constexpr std::string_view str = Fmt.view();
+
+  /**
+   * @brief Checks at compile time that the format string accepts Args.
+   *
+   * A mismatch (wrong count, a spec the type does not support...) is a
+   * compile error, exactly like a bad std::format call.
+   */
+  template <typename... Args> static consteval bool check() {
+    std::format_string<const Args &...> checked(Fmt.view());
+    (void)checked;
+    return true;
+  }
+};
+
+/**
+ * @class FormatMessage
+ * @brief A compile-time checked format string and a tuple of typed arguments
+ * that implements IMessage.
+ *
+ * Only the arguments are stored; the format string is identified by
+ * Format<Fmt>::id and formatted when the message is converted to a string,
+ * i.e. on the backend thread.
+ *
+ * @tparam Fmt The format string.
+ * @tparam Args The argument types, each formattable with std::format.
+ */
+template <FixedString Fmt, typename... Args>
+class FormatMessage : public Spektral::Log::IMessage {
+  static_assert(Format<Fmt>::template check<Args...>());
+
+public:
+  /// The compile-time id of the format string.
+  static constexpr std::uint64_t id = Format<Fmt>::id;
+  /// The format string.
+  static constexpr std::string_view format = Format<Fmt>::str;
+
+  /**
+   * @brief Constructs a message from its arguments.
+   *
+   * @param args The arguments, moved into the message.
+   */
+  explicit FormatMessage(Args... args) : _args(std::move(args)...) {}
+
+  operator std::string() override {
+    return std::apply(
+        [](const Args &...args) {
+          return std::vformat(format, std::make_format_args(args...));
+        },
+        _args);
+  }
+
+  void format_to(std::string &out) override {
+    std::apply(
+        [&out](const Args &...args) {
+          std::vformat_to(std::back_inserter(out), format,
+                          std::make_format_args(args...));
+        },
+        _args);
+  }
+
+  /// The arguments of the message.
+  const std::tuple<Args...> &args() const { return _args; }
+
+  /**
+   * @brief Creates and returns a pointer to a new FormatMessage object.
+   *
+   * @param args The arguments of the format string.
+   * @return A unique pointer to the new FormatMessage.
+   */
+  static std::unique_ptr<FormatMessage> Make(Args... args) {
+    return std::make_unique<FormatMessage>(std::move(args)...);
+  }
+
+private:
+  /// The arguments of the format string.
+  std::tuple<Args...> _args;
+};
+
+/**
+ * @brief Creates a FormatMessage by value, deducing its argument types.
+ *
+ * When the arguments are small the message is stored inline in the LogEvent,
+ * so logging it does not allocate.
+ *
+ * Example:
+ * @code
+ * logger.insert({LogLevel::INFO, Source<std::string>("net"),
+ *                make_message<"sent {} bytes to {}">(n, host)});
+ * @endcode
+ *
+ * @tparam Fmt The format string, checked against Args at compile time.
+ * @param args The arguments, copied or moved into the message. Pointers,
+ * including C strings, are stored as is and must outlive the message.
+ */
+template <FixedString Fmt, typename... Args>
+FormatMessage<Fmt, std::decay_t<Args>...> make_message(Args &&...args) {
+  return FormatMessage<Fmt, std::decay_t<Args>...>(std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Whether key can name a field of a StructuredMessage: letters, digits,
+ * '_', '.' and '-', so that it never needs escaping, and not one of the
+ * fields every record has ("ts", "level", "source" and "msg").
+ */
+consteval bool valid_field_key(std::string_view key) {
+  if (key.empty() || key == "ts" || key == "level" || key == "source" ||
+      key == "msg")
+    return false;
+  return std::ranges::all_of(key, [](char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_' || c == '.' || c == '-';
+  });
+}
+
+/**
+ * @struct Field
+ * @brief A typed value named by a compile-time key, see field().
+ *
+ * @tparam Key The name of the field, checked by valid_field_key().
+ * @tparam T The type of the value, see Encoder::append_value().
+ */
+template <FixedString Key, typename T> struct Field {
+  static_assert(valid_field_key(Key.view()),
+                "field keys are [A-Za-z0-9_.-]+ and not ts, level, source or "
+                "msg");
+
+  /// The name of the field.
+  static constexpr std::string_view key = Key.view();
+  /// The value of the field.
+  T value;
+};
+
+/**
+ * @brief Creates a Field, deducing the type of its value.
+ *
+ * @tparam Key The name of the field.
+ * @param value The value, copied or moved into the field. Pointers, including
+ * C strings, are stored as is and must outlive the message.
+ */
+template <FixedString Key, typename T>
+Field<Key, std::decay_t<T>> field(T &&value) {
+  return {std::forward<T>(value)};
+}
+
+/**
+ * @class StructuredMessage
+ * @brief A message text and typed key/value fields that implements IMessage.
+ *
+ * The keys are template arguments, so only the values are stored and the
+ * message usually fits inline in the LogEvent. With OutputFormat::JSON or
+ * LOGFMT the text becomes the "msg" field and each field its own, with its
+ * type kept (numbers stay numbers); the text format writes
+ * "<text> key=value ...".
+ *
+ * @tparam Msg The message text.
+ * @tparam Fields The fields, each a Field<Key, T>.
+ */
+template <FixedString Msg, typename... Fields>
+class StructuredMessage : public Spektral::Log::IMessage {
+public:
+  /// The message text.
+  static constexpr std::string_view text = Msg.view();
+
+  /**
+   * @brief Constructs a message from its fields.
+   *
+   * @param fields The fields, moved into the message.
+   */
+  explicit StructuredMessage(Fields... fields) : _fields(std::move(fields)...) {}
+
+  operator std::string() override {
+    std::string out;
+    format_to(out);
+    return out;
+  }
+
+  void format_to(std::string &out) override {
+    out += text;
+    std::apply(
+        [&out](const Fields &...fields) {
+          ((out += ' ', out += Fields::key, out += '=',
+            Encoder::append_value(out, fields.value, OutputFormat::LOGFMT)),
+           ...);
+        },
+        _fields);
+  }
+
+  void encode_to(Encoder &enc) override {
+    enc.field("msg", text);
+    std::apply(
+        [&enc](const Fields &...fields) {
+          (enc.field(Fields::key, fields.value), ...);
+        },
+        _fields);
+  }
+
+  /// The fields of the message.
+  const std::tuple<Fields...> &fields() const { return _fields; }
+
+private:
+  /// The fields.
+  std::tuple<Fields...> _fields;
+};
+
+/**
+ * @brief Creates a StructuredMessage by value.
+ *
+ * Example:
+ * @code
+ * logger.insert({LogLevel::INFO, "net",
+ *                make_structured<"sent">(field<"bytes">(n),
+ *                                        field<"host">(host))});
+ * // JSON: {"ts":"...","level":"INFO","source":"net","msg":"sent",
+ * //        "bytes":42,"host":"example.com"}
+ * @endcode
+ *
+ * @tparam Msg The message text.
+ * @param fields The fields, made by field().
+ */
+template <FixedString Msg, typename... Fields>
+StructuredMessage<Msg, std::decay_t<Fields>...>
+make_structured(Fields &&...fields) {
+  return StructuredMessage<Msg, std::decay_t<Fields>...>(
+      std::forward<Fields>(fields)...);
+}
 } // namespace Spektral::Log
@@ -0,0 +1,148 @@
+/// @file: include/Overflow.hpp
+/// @brief: what a logger does when a producer's queue is full.
+///
+/// 1. defines the OverflowPolicy enum, selectable per logger.
+/// 2. provides class OverflowQueue, the per-thread event queue of FileLogger
+/// and ConsoleLogger, which applies the policy and counts dropped events.
+
+#pragma once
+#include "LogEvent.hpp"
+#include "StagingQueue.hpp"
+#include "WaitStrategy.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <variant>
+
+namespace Spektral::Log {
+
+/**
+ * @enum OverflowPolicy
+ * @brief Defines what happens to an event whose producer's queue is full,
+ * e.g. while the disk stalls.
+ *
+ * - THROW: Throw full_queue_exception.
+ * - BLOCK: Wait until the backend has made room. Nothing is lost, but the
+ *   producer stalls with the backend.
+ * - DROP_NEWEST: Drop the event.
+ * - DROP_OLDEST: Drop the oldest event still queued by the same thread to make
+ *   room. Popping costs the backend a CAS, so only queues with this policy
+ *   pay for it.
+ * - DROP_BELOW_LEVEL: Drop the event if its level sorts below the logger's
+ *   overflow level, BLOCK otherwise.
+ *
+ * Whatever the policy, a queue never holds more than LOG_LANE_SZ events per
+ * thread, so producers stop allocating once it is full. Dropped events are
+ * counted and reported in the log by a WARN event once the backend has caught
+ * up.
+ */
+enum class OverflowPolicy : char {
+  THROW = 0,           ///< Throw full_queue_exception
+  BLOCK = 1,           ///< Wait for room
+  DROP_NEWEST = 2,     ///< Drop the event being logged
+  DROP_OLDEST = 3,     ///< Drop the oldest queued event
+  DROP_BELOW_LEVEL = 4 ///< Drop low levels, wait for room for the others
+};
+
+/**
+ * @class OverflowQueue
+ * @brief Per-thread lanes of LogEvents that apply an OverflowPolicy when the
+ * calling thread's lane is full.
+ *
+ * The fast path is a StagingQueue::try_push(); the policy is only looked at
+ * once it fails.
+ */
+class OverflowQueue {
+public:
+  /**
+   * @brief Constructs a queue without any lanes.
+   *
+   * @param policy What push() does when the lane is full. Default: THROW.
+   * @param level The lowest level DROP_BELOW_LEVEL keeps. Default: ERROR.
+   * @param lane_capacity The capacity of each thread's lane. Must be a power of
+   * two. Default: LOG_LANE_SZ.
+   */
+  explicit OverflowQueue(OverflowPolicy policy = OverflowPolicy::THROW,
+                         LogLevel level = LogLevel::ERROR,
+                         std::size_t lane_capacity = LOG_LANE_SZ);
+
+  OverflowQueue(const OverflowQueue &) = delete;
+  OverflowQueue &operator=(const OverflowQueue &) = delete;
+
+  /**
+   * @brief Pushes an event into the calling thread's lane, applying the
+   * policy if it is full.
+   *
+   * @param event The event to push.
+   * @param waiter The backend's Waiter, woken while BLOCK waits for room.
+   * @return Whether event was queued.
+   *
+   * @throw full_queue_exception If the lane is full and the policy is THROW.
+   */
+  bool push(LogEvent &&event, Waiter &waiter) {
+    if (auto *lanes = std::get_if<Lanes>(&_lanes)) {
+      if (lanes->try_push(std::move(event)))
+        return true;
+    } else if (std::get<EvictingLanes>(_lanes).try_push(std::move(event))) {
+      return true;
+    }
+    return overflow(std::move(event), waiter);
+  }
+
+  /**
+   * @brief Pops events from every lane, see StagingQueue::drain(). Must only
+   * be called from the consumer thread.
+   */
+  template <typename F>
+  std::size_t drain(F &&f, std::size_t max_per_lane = 256) {
+    return std::visit(
+        [&](auto &lanes) { return lanes.drain(f, max_per_lane); }, _lanes);
+  }
+
+  /**
+   * @brief Checks whether every lane is empty. Must only be called from the
+   * consumer thread.
+   */
+  bool empty() {
+    return std::visit([](auto &lanes) { return lanes.empty(); }, _lanes);
+  }
+
+  /**
+   * @brief Builds the WARN event reporting the events dropped since the last
+   * report. Must only be called from the consumer thread.
+   *
+   * @return The report, or std::nullopt if nothing was dropped or the lanes
+   * are not empty yet, i.e. the pressure has not cleared.
+   */
+  std::optional<LogEvent> report_dropped();
+
+  /// The number of events dropped so far.
+  std::uint64_t dropped() const noexcept {
+    return _dropped.load(std::memory_order_relaxed);
+  }
+
+  /// The policy applied to a full lane.
+  OverflowPolicy policy() const noexcept { return _policy; }
+
+private:
+  using Lanes = StagingQueue<LogEvent>;
+  using EvictingLanes = StagingQueue<LogEvent, EvictingRing<LogEvent>>;
+
+  /// Applies the policy to event, whose lane was full. Kept out of line to
+  /// keep push() small.
+  bool overflow(LogEvent &&event, Waiter &waiter);
+
+  /// What push() does when the lane is full.
+  const OverflowPolicy _policy;
+  /// The lowest level DROP_BELOW_LEVEL keeps.
+  const LogLevel _level;
+  /// EvictingLanes for DROP_OLDEST, Lanes otherwise.
+  std::variant<Lanes, EvictingLanes> _lanes;
+  /// Events dropped so far, bumped by the producers.
+  alignas(cache_line_sz) std::atomic<std::uint64_t> _dropped{0};
+  /// The value of _dropped at the last report. Only used by the consumer.
+  std::uint64_t _reported{0};
+};
+
+} // namespace Spektral::Log
@@ -0,0 +1,152 @@
+/// @file: include/Payload.hpp
+/// @brief: the source or message of a LogEvent, with common types stored
+/// without a virtual interface.
+///
+/// 1. provides class Payload<I>, a closed set of built-in types plus an
+/// InlinePtr<I> for everything else.
+
+#pragma once
+#include "InlinePtr.hpp"
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace Spektral::Log {
+
+/**
+ * @class Payload
+ * @brief The source or the message of a LogEvent.
+ *
+ * Strings, C strings, integers, floating point numbers and bools are held as
+ * alternatives of a std::variant and formatted by a switch over the
+ * alternative, without a virtual call or a pointer to chase. Any other source
+ * or message, an object derived from I or a std::unique_ptr to one, is held by
+ * an InlinePtr<I> and formatted through I::format_to().
+ *
+ * Example:
+ * @code
+ * logger.insert({LogLevel::INFO, "main", 42});
+ * @endcode
+ *
+ * @tparam I The interface of the fallback, ISource or IMessage.
+ */
+template <typename I> class Payload {
+  /// Character types, which are not held as integers.
+  template <typename T>
+  static constexpr bool is_char =
+      std::same_as<T, char> || std::same_as<T, signed char> ||
+      std::same_as<T, unsigned char> || std::same_as<T, wchar_t> ||
+      std::same_as<T, char8_t> || std::same_as<T, char16_t> ||
+      std::same_as<T, char32_t>;
+
+public:
+  /// Holds what is not one of the built-in types.
+  using Virtual = InlinePtr<I>;
+
+  /// Constructs an empty payload, equal to nullptr.
+  Payload() noexcept = default;
+
+  /**
+   * @brief Holds an object derived from I, or takes ownership of a
+   * std::unique_ptr to one, see InlinePtr.
+   *
+   * @param val The object.
+   */
+  template <typename T>
+    requires std::constructible_from<Virtual, T &&>
+  Payload(T &&val) : _val(std::in_place_type<Virtual>, std::forward<T>(val)) {}
+
+  /// Holds a string.
+  Payload(std::string str) noexcept
+      : _val(std::in_place_type<std::string>, std::move(str)) {}
+
+  /// Holds a copy of a string.
+  Payload(std::string_view str)
+      : _val(std::in_place_type<std::string>, str) {}
+
+  /// Holds a C string, e.g. a literal, as is; it must outlive the event.
+  Payload(const char *str) noexcept
+      : _val(std::in_place_type<const char *>, str) {}
+
+  /// Holds a signed integer.
+  template <std::signed_integral T>
+    requires(!is_char<T>)
+  Payload(T val) noexcept : _val(std::in_place_type<std::int64_t>, val) {}
+
+  /// Holds an unsigned integer.
+  template <std::unsigned_integral T>
+    requires(!is_char<T> && !std::same_as<T, bool>)
+  Payload(T val) noexcept : _val(std::in_place_type<std::uint64_t>, val) {}
+
+  /// Holds a floating point number.
+  template <std::floating_point T>
+  Payload(T val) noexcept : _val(std::in_place_type<double>, val) {}
+
+  /// Holds a bool.
+  template <std::same_as<bool> T>
+  Payload(T val) noexcept : _val(std::in_place_type<bool>, val) {}
+
+  /**
+   * @brief Appends the payload to out.
+   *
+   * Numbers are written like std::format("{}") writes them.
+   *
+   * @param out The buffer to append to.
+   */
+  void format_to(std::string &out) const {
+    std::visit(
+        [&out](const auto &val) {
+          using T = std::decay_t<decltype(val)>;
+          if constexpr (std::same_as<T, Virtual>) {
+            val->format_to(out);
+          } else if constexpr (std::same_as<T, std::string> ||
+                               std::same_as<T, const char *>) {
+            out += val;
+          } else if constexpr (std::same_as<T, bool>) {
+            out += val ? "true" : "false";
+          } else {
+            char buf[32];
+            auto res = std::to_chars(buf, buf + sizeof(buf), val);
+            out.append(buf, res.ptr);
+          }
+        },
+        _val);
+  }
+
+  /// Converts the payload to a string.
+  explicit operator std::string() const {
+    std::string out;
+    format_to(out);
+    return out;
+  }
+
+  /// The object behind the fallback, nullptr for the built-in types.
+  I *get() const noexcept {
+    const Virtual *ptr = std::get_if<Virtual>(&_val);
+    return ptr ? ptr->get() : nullptr;
+  }
+
+  /// Whether the payload is empty: a null fallback or a null C string.
+  friend bool operator==(const Payload &payload, std::nullptr_t) noexcept {
+    if (const Virtual *ptr = std::get_if<Virtual>(&payload._val))
+      return *ptr == nullptr;
+    if (const char *const *str = std::get_if<const char *>(&payload._val))
+      return *str == nullptr;
+    return false;
+  }
+
+private:
+  /// The payload. The fallback comes first so that a default constructed
+  /// payload is empty.
+  std::variant<Virtual, std::string, const char *, std::int64_t,
+               std::uint64_t, double, bool>
+      _val;
+};
+
+} // namespace Spektral::Log
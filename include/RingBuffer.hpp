@@ -0,0 +1,547 @@
+/// @file: include/RingBuffer.hpp
+/// @brief: bounded lock-free queues used between log producers and the
+/// backend threads.
+///
+/// 1. defines LOG_MAX_SZ, the capacity of shared log queues, and LOG_LANE_SZ,
+/// the capacity of each thread's lane.
+/// 2. provides class MpscRing<T>, a bounded multi-producer/single-consumer
+/// ring buffer.
+/// 3. provides class SpscRing<T>, a bounded single-producer/single-consumer
+/// ring buffer.
+/// 4. provides class EvictingRing<T>, a bounded single-producer/single-consumer
+/// ring buffer whose producer may discard the oldest element to make room.
+/// 5. provides class SpscByteRing, a single-producer/single-consumer ring of
+/// variable sized byte records.
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#ifndef LOG_MAX_SZ
+/**
+ * @brief Capacity (in events) of a log queue shared by every thread
+ * (MpscRing).
+ *
+ * Must be a power of two. Can be overridden at compile time with
+ * -DLOG_MAX_SZ=...
+ */
+#define LOG_MAX_SZ (1 << 17)
+#endif
+
+#ifndef LOG_LANE_SZ
+/**
+ * @brief Capacity (in events) of each thread's lane of a log queue.
+ *
+ * Every thread that logs gets a lane per logger, and a lane holds its events
+ * by value: once it has wrapped, all of it is resident. The default, 4096
+ * LogEvents, is under 1MiB per lane. Raise it for threads that log long
+ * bursts.
+ *
+ * Must be a power of two. Can be overridden at compile time with
+ * -DLOG_LANE_SZ=...
+ */
+#define LOG_LANE_SZ (1 << 12)
+#endif
+
+namespace Spektral::Log {
+
+/// Size used to pad indices that are written by different threads so that
+/// they never share a cache line.
+inline constexpr std::size_t cache_line_sz = 64;
+
+static_assert((LOG_MAX_SZ & (LOG_MAX_SZ - 1)) == 0,
+              "LOG_MAX_SZ must be a power of two");
+static_assert((LOG_LANE_SZ & (LOG_LANE_SZ - 1)) == 0,
+              "LOG_LANE_SZ must be a power of two");
+
+/**
+ * @class MpscRing
+ * @brief A bounded, lock-free, multi-producer/single-consumer ring buffer.
+ *
+ * Every slot carries a sequence number (Vyukov's bounded queue). Producers
+ * claim a slot by advancing the shared tail with a CAS, construct the value in
+ * place and then publish it by bumping the slot's sequence. The single
+ * consumer owns the head and never contends with the producers; it only
+ * observes the slot sequence numbers.
+ *
+ * The producer and consumer indices live on separate cache lines so that the
+ * consumer draining the queue does not invalidate the line the producers are
+ * fighting over.
+ *
+ * @tparam T The element type. Must be move constructible.
+ */
+template <typename T> class MpscRing {
+public:
+  /**
+   * @brief Constructs an empty ring.
+   *
+   * @param capacity The number of slots. Must be a power of two. Default:
+   * LOG_MAX_SZ.
+   */
+  explicit MpscRing(std::size_t capacity = LOG_MAX_SZ)
+      : _mask(capacity - 1), _slots(std::make_unique<Slot[]>(capacity)) {
+    for (std::size_t ii = 0; ii < capacity; ++ii)
+      _slots[ii].seq.store(ii, std::memory_order_relaxed);
+  }
+
+  MpscRing(const MpscRing &) = delete;
+  MpscRing &operator=(const MpscRing &) = delete;
+
+  /**
+   * @brief Destroys any element that was never consumed.
+   */
+  ~MpscRing() {
+    while (try_pop())
+      ;
+  }
+
+  /**
+   * @brief Attempts to push a value. Safe to call from any thread.
+   *
+   * @param val The value to move into the ring.
+   * @return false if the ring is full, in which case val is left untouched.
+   */
+  bool try_push(T &&val) {
+    std::size_t pos = _tail.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+      slot = &_slots[pos & _mask];
+      std::size_t seq = slot->seq.load(std::memory_order_acquire);
+      auto dif = static_cast<std::ptrdiff_t>(seq - pos);
+      if (dif == 0) {
+        if (_tail.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+          break;
+      } else if (dif < 0) {
+        return false;
+      } else {
+        pos = _tail.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (slot->storage) T(std::move(val));
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Attempts to pop the oldest value. Must only be called from the
+   * consumer thread.
+   *
+   * @return The value, or std::nullopt if the ring is empty.
+   */
+  std::optional<T> try_pop() {
+    Slot &slot = _slots[_head & _mask];
+    if (slot.seq.load(std::memory_order_acquire) != _head + 1)
+      return std::nullopt;
+    T *val = std::launder(reinterpret_cast<T *>(slot.storage));
+    std::optional<T> ret(std::move(*val));
+    val->~T();
+    slot.seq.store(_head + _mask + 1, std::memory_order_release);
+    ++_head;
+    return ret;
+  }
+
+  /**
+   * @brief Checks whether the consumer has anything left to pop. Must only be
+   * called from the consumer thread.
+   */
+  bool empty() const {
+    return _slots[_head & _mask].seq.load(std::memory_order_acquire) !=
+           _head + 1;
+  }
+
+  /// The number of slots in the ring.
+  std::size_t capacity() const { return _mask + 1; }
+
+private:
+  /// A single cell of the ring, the sequence number guards the storage.
+  struct Slot {
+    std::atomic<std::size_t> seq;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  /// capacity - 1, used to wrap the indices.
+  const std::size_t _mask;
+  /// The slots themselves.
+  std::unique_ptr<Slot[]> _slots;
+  /// Next position to be claimed by a producer.
+  alignas(cache_line_sz) std::atomic<std::size_t> _tail{0};
+  /// Next position to be read by the consumer.
+  /// The class alignment pads whatever follows the ring off this line.
+  alignas(cache_line_sz) std::size_t _head{0};
+};
+
+/**
+ * @class SpscRing
+ * @brief A bounded, lock-free, single-producer/single-consumer ring buffer.
+ *
+ * The producer only writes the tail and the consumer only writes the head.
+ * Each side keeps a private copy of the other side's index and only re-reads
+ * the shared one when the copy says the ring is full (producer) or empty
+ * (consumer), so in steady state neither side touches the other's cache line.
+ *
+ * @tparam T The element type. Must be move constructible.
+ */
+template <typename T> class SpscRing {
+public:
+  /**
+   * @brief Constructs an empty ring.
+   *
+   * @param capacity The number of slots. Must be a power of two. Default:
+   * LOG_LANE_SZ.
+   */
+  explicit SpscRing(std::size_t capacity = LOG_LANE_SZ)
+      : _mask(capacity - 1),
+        _slots(std::make_unique_for_overwrite<Slot[]>(capacity)) {}
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  /**
+   * @brief Destroys any element that was never consumed.
+   */
+  ~SpscRing() {
+    while (try_pop())
+      ;
+  }
+
+  /**
+   * @brief Attempts to push a value. Must only be called from the producer
+   * thread.
+   *
+   * @param val The value to move into the ring.
+   * @return false if the ring is full, in which case val is left untouched.
+   */
+  bool try_push(T &&val) {
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head_cache > _mask) {
+      _head_cache = _head.load(std::memory_order_acquire);
+      if (tail - _head_cache > _mask)
+        return false;
+    }
+    ::new (_slots[tail & _mask].storage) T(std::move(val));
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Attempts to pop the oldest value. Must only be called from the
+   * consumer thread.
+   *
+   * @return The value, or std::nullopt if the ring is empty.
+   */
+  std::optional<T> try_pop() {
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail_cache) {
+      _tail_cache = _tail.load(std::memory_order_acquire);
+      if (head == _tail_cache)
+        return std::nullopt;
+    }
+    T *val = std::launder(reinterpret_cast<T *>(_slots[head & _mask].storage));
+    std::optional<T> ret(std::move(*val));
+    val->~T();
+    _head.store(head + 1, std::memory_order_release);
+    return ret;
+  }
+
+  /**
+   * @brief Checks whether the consumer has anything left to pop. Must only be
+   * called from the consumer thread.
+   */
+  bool empty() const {
+    return _head.load(std::memory_order_relaxed) ==
+           _tail.load(std::memory_order_acquire);
+  }
+
+  /// The number of slots in the ring.
+  std::size_t capacity() const { return _mask + 1; }
+
+private:
+  /// Raw storage for a single element.
+  struct Slot {
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  /// capacity - 1, used to wrap the indices.
+  const std::size_t _mask;
+  /// The slots themselves, left uninitialized: constructing the ring does
+  /// not touch them, but a ring that has wrapped once is fully resident.
+  std::unique_ptr<Slot[]> _slots;
+  /// Next position to be written by the producer.
+  alignas(cache_line_sz) std::atomic<std::size_t> _tail{0};
+  /// The producer's last observed value of _head.
+  std::size_t _head_cache{0};
+  /// Next position to be read by the consumer.
+  alignas(cache_line_sz) std::atomic<std::size_t> _head{0};
+  /// The consumer's last observed value of _tail.
+  std::size_t _tail_cache{0};
+};
+
+/**
+ * @class EvictingRing
+ * @brief A bounded, lock-free, single-producer/single-consumer ring buffer
+ * whose producer can also take the oldest element.
+ *
+ * Like MpscRing, every slot carries a sequence number; unlike it, the head is
+ * claimed with a CAS so that the producer may evict() the oldest element
+ * while the consumer pops. Whoever wins the CAS owns the slot until it bumps
+ * the slot's sequence, so the producer never writes a slot the consumer is
+ * still reading. The CAS makes popping slower than SpscRing's, so only use
+ * this ring when eviction is needed.
+ *
+ * @tparam T The element type. Must be move constructible.
+ */
+template <typename T> class EvictingRing {
+public:
+  /**
+   * @brief Constructs an empty ring.
+   *
+   * @param capacity The number of slots. Must be a power of two. Default:
+   * LOG_LANE_SZ. All of it is written, and so resident, right away.
+   */
+  explicit EvictingRing(std::size_t capacity = LOG_LANE_SZ)
+      : _mask(capacity - 1), _slots(std::make_unique<Slot[]>(capacity)) {
+    for (std::size_t ii = 0; ii < capacity; ++ii)
+      _slots[ii].seq.store(ii, std::memory_order_relaxed);
+  }
+
+  EvictingRing(const EvictingRing &) = delete;
+  EvictingRing &operator=(const EvictingRing &) = delete;
+
+  /**
+   * @brief Destroys any element that was never consumed.
+   */
+  ~EvictingRing() {
+    while (try_pop())
+      ;
+  }
+
+  /**
+   * @brief Attempts to push a value. Must only be called from the producer
+   * thread.
+   *
+   * @param val The value to move into the ring.
+   * @return false if the ring is full, in which case val is left untouched.
+   */
+  bool try_push(T &&val) {
+    Slot &slot = _slots[_tail & _mask];
+    if (slot.seq.load(std::memory_order_acquire) != _tail)
+      return false;
+    ::new (slot.storage) T(std::move(val));
+    slot.seq.store(_tail + 1, std::memory_order_release);
+    ++_tail;
+    return true;
+  }
+
+  /**
+   * @brief Attempts to pop the oldest value. Must only be called from the
+   * consumer thread.
+   *
+   * @return The value, or std::nullopt if the ring is empty.
+   */
+  std::optional<T> try_pop() { return claim(); }
+
+  /**
+   * @brief Takes the oldest value out of the ring to make room. Must only be
+   * called from the producer thread.
+   *
+   * @return The evicted value, or std::nullopt if the consumer got to it (or
+   * to every value) first, in which case a slot frees up as soon as the
+   * consumer is done reading it.
+   */
+  std::optional<T> evict() { return claim(); }
+
+  /**
+   * @brief Checks whether the consumer has anything left to pop. Must only be
+   * called from the consumer thread.
+   */
+  bool empty() const {
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    return _slots[head & _mask].seq.load(std::memory_order_acquire) !=
+           head + 1;
+  }
+
+  /// The number of slots in the ring.
+  std::size_t capacity() const { return _mask + 1; }
+
+private:
+  /// A single cell of the ring, the sequence number guards the storage.
+  struct Slot {
+    std::atomic<std::size_t> seq;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  /// Claims the oldest published slot, moves its value out and hands the slot
+  /// back to the producer.
+  std::optional<T> claim() {
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &slot = _slots[head & _mask];
+      if (slot.seq.load(std::memory_order_acquire) != head + 1)
+        return std::nullopt;
+      if (_head.compare_exchange_weak(head, head + 1,
+                                      std::memory_order_relaxed)) {
+        T *val = std::launder(reinterpret_cast<T *>(slot.storage));
+        std::optional<T> ret(std::move(*val));
+        val->~T();
+        slot.seq.store(head + _mask + 1, std::memory_order_release);
+        return ret;
+      }
+    }
+  }
+
+  /// capacity - 1, used to wrap the indices.
+  const std::size_t _mask;
+  /// The slots themselves.
+  std::unique_ptr<Slot[]> _slots;
+  /// Next position to be written by the producer; only the producer uses it.
+  alignas(cache_line_sz) std::size_t _tail{0};
+  /// Next position to be claimed, by the consumer or an evicting producer.
+  alignas(cache_line_sz) std::atomic<std::size_t> _head{0};
+};
+
+/**
+ * @class SpscByteRing
+ * @brief A bounded, lock-free, single-producer/single-consumer ring of variable
+ * sized byte records.
+ *
+ * The producer reserve()s room for a record, writes it in place and commit()s
+ * it; the consumer peek()s at the oldest record, reads it in place and pop()s
+ * it. Records are always contiguous: when one does not fit before the end of
+ * the buffer the producer leaves a wrap marker and starts over at offset 0.
+ * Every record is preceded by an 8 byte header and padded to 8 bytes, so
+ * record bodies are 8 byte aligned.
+ */
+class SpscByteRing {
+public:
+  /**
+   * @brief Constructs an empty ring.
+   *
+   * @param capacity The size of the buffer in bytes. Must be a power of two.
+   */
+  explicit SpscByteRing(std::size_t capacity)
+      : _mask(capacity - 1), _buf(new std::uint64_t[capacity / 8]) {}
+
+  SpscByteRing(const SpscByteRing &) = delete;
+  SpscByteRing &operator=(const SpscByteRing &) = delete;
+
+  /**
+   * @brief Reserves room for a record of n bytes. Must only be called from the
+   * producer thread.
+   *
+   * @param n The size of the record.
+   * @return Where to write the record, or nullptr if the ring is full.
+   */
+  char *reserve(std::size_t n) {
+    std::size_t need = (header_sz + n + 7) & ~std::size_t{7};
+    if (need > _mask + 1)
+      return nullptr;
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    std::size_t off = tail & _mask;
+    std::size_t pad = off + need > _mask + 1 ? _mask + 1 - off : 0;
+    if (tail + pad + need - _head_cache > _mask + 1) {
+      _head_cache = _head.load(std::memory_order_acquire);
+      if (tail + pad + need - _head_cache > _mask + 1)
+        return nullptr;
+    }
+    if (pad) {
+      std::memcpy(bytes() + off, &wrap_marker, sizeof(wrap_marker));
+      tail += pad;
+      off = 0;
+    }
+    auto len = static_cast<std::uint32_t>(n);
+    std::memcpy(bytes() + off, &len, sizeof(len));
+    _pending_tail = tail + need;
+    return bytes() + off + header_sz;
+  }
+
+  /**
+   * @brief Publishes the record returned by the last reserve(). Must only be
+   * called from the producer thread.
+   */
+  void commit() { _tail.store(_pending_tail, std::memory_order_release); }
+
+  /**
+   * @brief Looks at the oldest record. Must only be called from the consumer
+   * thread.
+   *
+   * @param rec Set to the record's bytes if there is one.
+   * @return false if the ring is empty.
+   */
+  bool peek(std::string_view &rec) {
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    for (;;) {
+      if (head == _tail_cache) {
+        _tail_cache = _tail.load(std::memory_order_acquire);
+        if (head == _tail_cache)
+          return false;
+      }
+      std::size_t off = head & _mask;
+      std::uint32_t len;
+      std::memcpy(&len, bytes() + off, sizeof(len));
+      if (len == wrap_marker) {
+        head += _mask + 1 - off;
+        _head.store(head, std::memory_order_release);
+        continue;
+      }
+      _peek_sz = (header_sz + len + 7) & ~std::size_t{7};
+      rec = {bytes() + off + header_sz, len};
+      return true;
+    }
+  }
+
+  /**
+   * @brief Releases the record returned by the last peek(). Must only be
+   * called from the consumer thread.
+   */
+  void pop() {
+    _head.store(_head.load(std::memory_order_relaxed) + _peek_sz,
+                std::memory_order_release);
+  }
+
+  /**
+   * @brief Checks whether the consumer has anything left to read. Must only be
+   * called from the consumer thread.
+   */
+  bool empty() const {
+    return _head.load(std::memory_order_relaxed) ==
+           _tail.load(std::memory_order_acquire);
+  }
+
+  /// The size of the buffer in bytes.
+  std::size_t capacity() const { return _mask + 1; }
+
+private:
+  /// Size of the length header in front of every record.
+  static constexpr std::size_t header_sz = 8;
+  /// Length value telling the consumer to skip to the start of the buffer.
+  static constexpr std::uint32_t wrap_marker = 0xFFFFFFFF;
+
+  char *bytes() const { return reinterpret_cast<char *>(_buf.get()); }
+
+  /// capacity - 1, used to wrap the indices.
+  const std::size_t _mask;
+  /// The buffer, allocated as words so that records are 8 byte aligned.
+  std::unique_ptr<std::uint64_t[]> _buf;
+  /// Next byte to be written by the producer.
+  alignas(cache_line_sz) std::atomic<std::size_t> _tail{0};
+  /// The producer's last observed value of _head.
+  std::size_t _head_cache{0};
+  /// Where _tail moves on commit().
+  std::size_t _pending_tail{0};
+  /// Next byte to be read by the consumer.
+  alignas(cache_line_sz) std::atomic<std::size_t> _head{0};
+  /// The consumer's last observed value of _tail.
+  std::size_t _tail_cache{0};
+  /// Size (header and padding included) of the record returned by peek().
+  std::size_t _peek_sz{0};
+};
+
+} // namespace Spektral::Log
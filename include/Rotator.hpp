@@ -0,0 +1,131 @@
+/// @file: include/Rotator.hpp
+/// @brief: the helper thread behind FileLogger's log rotation.
+///
+/// 1. provides class Rotator, which keeps the next file open ahead of time and
+/// renames, compresses and prunes the files rotated out.
+
+#pragma once
+#include "Sinks.hpp"
+#include "WaitStrategy.hpp"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace Spektral::Log {
+
+/**
+ * @class Rotator
+ * @brief Prepares the files a logger rotates to and disposes of the ones it
+ * rotates out, on a helper thread.
+ *
+ * The live file is always <path>. The helper opens the next one as
+ * "<path>.next" ahead of time and publishes its sink through an atomic slot;
+ * try_rotate(), called by the backend between batches, swaps it in without a
+ * system call and hands the old sink back through a second slot. The helper
+ * then renames <path> to "<path>.N" and "<path>.next" to <path>, closes the
+ * old file, opens the next one, and finally compresses "<path>.N" to
+ * "<path>.N.gz" and deletes the oldest rotated files beyond the retention
+ * count. Writes never go to the wrong file while the renames are pending:
+ * they follow the file descriptors, not the names.
+ *
+ * Rotated files are numbered after the highest "<path>.N" found on startup,
+ * so a restart never overwrites them.
+ */
+class Rotator {
+public:
+  /// Opens a sink writing to a path, for the next file.
+  using SinkFactory = std::function<std::unique_ptr<ISink>(const std::string &)>;
+
+  /**
+   * @brief Starts the helper thread, which opens the first next file.
+   *
+   * @param path The path of the live file.
+   * @param open_sink Opens the sink of a new file.
+   * @param retain How many rotated files are kept, 0 for all.
+   * @param compress Whether rotated files are gzip-compressed. Ignored when
+   * built without zlib.
+   * @param waiter The backend's Waiter, woken when the next file is ready.
+   */
+  Rotator(std::string path, SinkFactory open_sink, unsigned retain,
+          bool compress, Waiter &waiter);
+
+  Rotator(const Rotator &) = delete;
+  Rotator &operator=(const Rotator &) = delete;
+
+  /**
+   * @brief Finishes the pending renames and compression, removes the unused
+   * next file and stops the helper thread.
+   */
+  ~Rotator();
+
+  /**
+   * @brief Swaps sink for the next file, if it is ready. Must only be called
+   * from the backend thread, after everything meant for the old file has been
+   * written to sink.
+   *
+   * @param sink The live sink, replaced on success.
+   * @return Whether the file was rotated.
+   */
+  bool try_rotate(std::unique_ptr<ISink> &sink) {
+    ISink *next = _next.exchange(nullptr, std::memory_order_acquire);
+    if (!next)
+      return false;
+    // The helper publishes the next sink only after taking the last retired
+    // one, so the slot is free.
+    _retired.store(sink.release(), std::memory_order_release);
+    sink.reset(next);
+    _signal.fetch_add(1, std::memory_order_release);
+    _signal.notify_one();
+    return true;
+  }
+
+  /// Whether the next file is ready, i.e. try_rotate() would succeed.
+  bool ready() const noexcept {
+    return _next.load(std::memory_order_relaxed) != nullptr;
+  }
+
+private:
+  /// The helper thread's loop.
+  void run(std::stop_token stop);
+  /// Opens the next file and publishes its sink.
+  void prepare();
+  /// Renames the rotated file and the new live file and closes retired.
+  void retire(std::unique_ptr<ISink> retired);
+  /// Compresses "<path>.index" and deletes the rotated files past _retain.
+  void archive(std::uint64_t index);
+
+  /// The path of the live file.
+  const std::string _path;
+  /// The path the next file is opened at.
+  const std::string _next_path;
+  /// Opens the sink of a new file.
+  const SinkFactory _open_sink;
+  /// How many rotated files are kept, 0 for all.
+  const unsigned _retain;
+  /// Whether rotated files are compressed.
+  const bool _compress;
+  /// Woken when the next file is ready.
+  Waiter &_waiter;
+  /// The sink of the next file, set by the helper and taken by try_rotate().
+  std::atomic<ISink *> _next{nullptr};
+  /// The sink rotated out, set by try_rotate() and taken by the helper.
+  std::atomic<ISink *> _retired{nullptr};
+  /// Bumped to wake the helper.
+  std::atomic<std::uint32_t> _signal{0};
+  /// The indices of the rotated files kept, oldest first. Only used by the
+  /// helper.
+  std::deque<std::uint64_t> _kept;
+  /// The index of the last rotated file. Only used by the helper.
+  std::uint64_t _index;
+  /// Whether opening the next file failed. Only used by the helper.
+  bool _next_failed = false;
+  /// The helper thread; declared last so that it starts after, and stops
+  /// before, everything it uses.
+  std::jthread _helper;
+};
+
+} // namespace Spektral::Log
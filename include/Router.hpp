@@ -0,0 +1,121 @@
+/// @file: include/Router.hpp
+/// @brief: fans one event out to several loggers.
+///
+/// 1. provides class Router, which sends each event to every logger whose
+/// minimum level it meets, sharing its source and message between them.
+
+#pragma once
+#include "Clock.hpp"
+#include "LogEvent.hpp"
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+namespace Spektral::Log {
+
+/**
+ * @class Router
+ * @brief Sends events to several loggers, each with its own minimum level.
+ *
+ * An event going to more than one logger is stamped once and its source and
+ * message are moved into a single reference counted, immutable block. Each
+ * logger receives a LogEvent that points to the block instead of a copy, and
+ * formats it on its own backend thread; the last one to finish frees it.
+ * Since the backends may format the same source and message concurrently,
+ * their format_to() must not modify them (true of every built-in type).
+ *
+ * Every logger has its own queue and OverflowPolicy. With THROW, a logger
+ * whose queue is full drops the event, counted by dropped(), without holding
+ * back the others; with BLOCK (or DROP_BELOW_LEVEL) it holds back the loggers
+ * after it until it has room.
+ *
+ * Example:
+ * @code
+ * Router router;
+ * router.add(ConsoleLogger::get_inst(LogLevel::INFO), LogLevel::WARN);
+ * router.add(file_logger, LogLevel::INFO);
+ * router.log(LogLevel::INFO, "main", "only in the file");
+ * @endcode
+ */
+class Router {
+public:
+  /**
+   * @brief Constructs a Router without routes.
+   *
+   * @param clock Where events are stamped. Default: ClockSource::SYSTEM.
+   */
+  explicit Router(ClockSource clock = ClockSource::SYSTEM);
+
+  /**
+   * @brief Adds a route. Not thread-safe: add every route before logging.
+   *
+   * @param logger Any logger with insert(LogEvent &&), e.g. a FileLogger or
+   * the ConsoleLogger. Must outlive the Router.
+   * @param min_level The minimum LogLevel sent to logger.
+   * @return The index of the route, for dropped().
+   */
+  template <typename Logger>
+    requires requires(Logger &logger, LogEvent &&event) {
+      logger.insert(std::move(event));
+    }
+  std::size_t add(Logger &logger, LogLevel min_level) {
+    _routes.emplace_back(min_level, &logger, [](void *dst, LogEvent &&event) {
+      static_cast<Logger *>(dst)->insert(std::move(event));
+    });
+    if (_routes.size() == 1 || min_level < _min_level)
+      _min_level = min_level;
+    return _routes.size() - 1;
+  }
+
+  /// Whether at least one route takes events at level.
+  bool enabled(LogLevel level) const noexcept {
+    return !_routes.empty() && level >= _min_level;
+  }
+
+  /**
+   * @brief Sends an event to every route whose minimum level it meets.
+   *
+   * @param level The severity level of the event.
+   * @param source The source of the event, see LogEvent::LogEvent.
+   * @param message The message of the event, see LogEvent::LogEvent.
+   *
+   * @throw message_nullptr_exception
+   * @throw source_nullptr_exception
+   */
+  void log(LogLevel level, Payload<ISource> source, Payload<IMessage> message);
+
+  /// The number of events route dropped because its logger's queue was full
+  /// and its overflow policy was THROW. See the logger's dropped() for the
+  /// other policies.
+  std::uint64_t dropped(std::size_t route) const noexcept {
+    return _routes[route].dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+  /// A logger and the events it takes.
+  struct Route {
+    Route(LogLevel min_level, void *logger, void (*insert)(void *, LogEvent &&))
+        : min_level(min_level), logger(logger), insert(insert) {}
+
+    LogLevel min_level;
+    void *logger;
+    void (*insert)(void *logger, LogEvent &&event);
+    std::atomic<std::uint64_t> dropped{0};
+  };
+
+  /// Inserts event into route, counting it as dropped if the queue is full.
+  static void send(Route &route, LogEvent &&event);
+
+  /// Stamps the events.
+  const Clock _clock;
+  /// The routes, in the order they were added. A deque keeps the atomics in
+  /// place.
+  std::deque<Route> _routes;
+  /// The lowest minimum level of any route.
+  LogLevel _min_level = LogLevel::INFO;
+};
+
+} // namespace Spektral::Log
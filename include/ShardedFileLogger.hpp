@@ -0,0 +1,121 @@
+/// @file: include/ShardedFileLogger.hpp
+/// @brief: spreads events over several FileLoggers, each with its own backend
+/// thread and file.
+///
+/// 1. defines the ShardBy enum.
+/// 2. provides class ShardedFileLogger, which writes <path>.0 ... <path>.K-1
+/// in parallel. tools/logmerge merges them back into one file.
+
+#pragma once
+#include "Clock.hpp"
+#include "FileLogger.hpp"
+#include "LogEvent.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Spektral::Log {
+
+/**
+ * @enum ShardBy
+ * @brief Defines which shard an event goes to.
+ *
+ * - THREAD: Threads are assigned to shards round-robin, the first time they
+ *   log. Balances the load as long as the threads log at similar rates.
+ * - SOURCE: The source's text is hashed, so all events of a source end up in
+ *   the same file. Costs formatting the source on the calling thread.
+ */
+enum class ShardBy : char {
+  THREAD = 0, ///< By logging thread
+  SOURCE = 1  ///< By hash of the source
+};
+
+/**
+ * @class ShardedFileLogger
+ * @brief Logs to K files through K FileLoggers, so formatting and writing are
+ * spread over K backend threads.
+ *
+ * A single FileLogger's backend formats every event on one core; sharding
+ * lifts that limit at the cost of splitting the log. Every record starts with
+ * its timestamp, which is what tools/logmerge merges the shards by, so the
+ * timestamps should be precise enough to order the events (the default,
+ * TimestampPrecision::NANOS, is).
+ *
+ * Example:
+ * @code
+ * ShardedFileLogger logger("logs/trades.log", 4);
+ * logger.emplace(LogLevel::INFO, "book", "filled");
+ * // $ logmerge logs/trades.log.0 logs/trades.log.1 ... -o logs/trades.log
+ * @endcode
+ */
+class ShardedFileLogger {
+public:
+  /**
+   * @brief Opens (and truncates) shard_path(file_path, k) for every shard k.
+   *
+   * @param file_path The path the shard files are named after.
+   * @param shards The number of shards, i.e. files and backend threads.
+   * @param by How events are assigned to shards. Default: ShardBy::THREAD.
+   * @param opts The options of every shard's FileLogger.
+   *
+   * @throws std::invalid_argument If shards is 0.
+   * @throws std::runtime_error If a file cannot be opened.
+   */
+  ShardedFileLogger(const std::string &file_path, std::size_t shards,
+                    ShardBy by = ShardBy::THREAD, const FileOptions &opts = {});
+
+  /**
+   * @brief Inserts an event into its shard's queue, see FileLogger::insert().
+   *
+   * @param event The LogEvent to be inserted.
+   *
+   * @throw full_queue_exception If the shard's queue is full and
+   * FileOptions::overflow is THROW.
+   */
+  void insert(LogEvent &&event) {
+    _shards[shard_of(event)]->insert(std::move(event));
+  }
+
+  /**
+   * @brief Builds a LogEvent stamped with FileOptions::clock and inserts it.
+   *
+   * @param level The severity level of the event.
+   * @param source The source of the event, passed as to LogEvent::LogEvent.
+   * @param message The message of the event, passed as to LogEvent::LogEvent.
+   *
+   * @throw full_queue_exception If the shard's queue is full and
+   * FileOptions::overflow is THROW.
+   */
+  void emplace(LogLevel level, Payload<ISource> source,
+               Payload<IMessage> message) {
+    insert(LogEvent(level, _clock.now(), std::move(source), std::move(message)));
+  }
+
+  /// The number of shards.
+  std::size_t shards() const noexcept { return _shards.size(); }
+
+  /// The number of events dropped by all shards, see FileLogger::dropped().
+  std::uint64_t dropped() const noexcept;
+
+  /**
+   * @brief The path of a shard's file: file_path followed by "." and the
+   * shard's index.
+   */
+  static std::string shard_path(const std::string &file_path,
+                                std::size_t shard);
+
+private:
+  /// Picks event's shard according to _by.
+  std::size_t shard_of(const LogEvent &event) const;
+
+  /// How events are assigned to shards.
+  const ShardBy _by;
+  /// Timestamps the events built by emplace().
+  const Clock _clock;
+  /// One FileLogger per shard.
+  std::vector<std::unique_ptr<FileLogger>> _shards;
+};
+
+} // namespace Spektral::Log
@@ -0,0 +1,231 @@
+/// @file: include/Sinks.hpp
+/// @brief: provides implementations of the ISink interface, the last stage of
+/// the FileLogger backend.
+///
+/// 1. defines the ISink interface, which writes formatted batches somewhere.
+/// 2. provides class FdSink, which writes with write(2).
+/// 3. provides class IoUringSink, which submits writes through io_uring.
+/// 4. provides class MmapSink, which copies into preallocated, memory-mapped
+/// file segments.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Spektral::Log {
+
+/**
+ * @class ISink
+ * @brief Interface for the destination of formatted log batches.
+ *
+ * A sink is only ever used from a single backend thread.
+ */
+class ISink {
+public:
+  /**
+   * @brief Writes a formatted batch.
+   *
+   * The sink must be done with data when write() returns, either because it
+   * has been written or because the sink copied it; the caller reuses the
+   * buffer right away.
+   *
+   * @param data The bytes to append.
+   */
+  virtual void write(std::string_view data) = 0;
+
+  /**
+   * @brief Blocks until every previous write() has reached the file.
+   */
+  virtual void sync() {}
+
+  /**
+   * @brief Virtual destructor.
+   *
+   * Ensures proper cleanup of derived classes.
+   */
+  virtual ~ISink() = default;
+};
+
+/**
+ * @class FdSink
+ * @brief Writes batches synchronously with write(2).
+ */
+class FdSink : public ISink {
+public:
+  /**
+   * @brief Constructs a sink writing to fd.
+   *
+   * @param fd An open, writable file descriptor.
+   * @param owned Whether the destructor closes fd. Default: true; false for
+   * e.g. STDOUT_FILENO.
+   */
+  explicit FdSink(int fd, bool owned = true);
+  ~FdSink() override;
+  FdSink(const FdSink &) = delete;
+  FdSink &operator=(const FdSink &) = delete;
+
+  /// Writes data, retrying short writes and EINTR, and waiting for room when
+  /// fd is a non-blocking pipe or terminal that is full.
+  void write(std::string_view data) override;
+
+private:
+  /// The file descriptor written to.
+  int _fd;
+  /// Whether the destructor closes _fd.
+  bool _owned;
+};
+
+/**
+ * @class IoUringSink
+ * @brief Writes batches asynchronously through io_uring.
+ *
+ * The file descriptor and a small set of staging buffers are registered with
+ * the ring, so every write is an IORING_OP_WRITE_FIXED on a fixed file.
+ * write() copies the batch into a free staging buffer, submits it and returns
+ * without waiting for it to complete; it only blocks when every buffer is
+ * still in flight. With two or more buffers the backend formats batch N+1
+ * while the kernel writes batch N.
+ */
+class IoUringSink : public ISink {
+public:
+  /**
+   * @brief Creates an IoUringSink if io_uring is usable.
+   *
+   * @param fd An open, writable file descriptor. Owned by the sink on
+   * success, untouched on failure.
+   * @param buffer_sz The size of each staging buffer.
+   * @param buffers The number of staging buffers (2 for double buffering, 3
+   * for triple buffering).
+   * @return The sink, or nullptr if io_uring is not available (old kernel,
+   * seccomp, missing headers at build time...).
+   */
+  static std::unique_ptr<IoUringSink> Make(int fd, std::size_t buffer_sz,
+                                           unsigned buffers = 3);
+  ~IoUringSink() override;
+  IoUringSink(const IoUringSink &) = delete;
+  IoUringSink &operator=(const IoUringSink &) = delete;
+
+  /// Copies data into staging buffers and submits it.
+  void write(std::string_view data) override;
+  /// Waits for every submitted write to complete.
+  void sync() override;
+
+private:
+  /// The kernel ring and its memory mappings.
+  struct Ring;
+  /// A registered staging buffer and the write it is part of.
+  struct Buffer {
+    char *data = nullptr;
+    std::size_t len = 0;   ///< Bytes the pending write covers
+    std::size_t done = 0;  ///< Bytes the kernel has written so far
+    std::uint64_t off = 0; ///< File offset of data[0]
+    bool busy = false;     ///< Whether the write is in flight
+  };
+
+  IoUringSink(int fd, std::unique_ptr<Ring> ring, std::size_t buffer_sz,
+              std::vector<Buffer> buffers);
+  /// Queues the unwritten remainder of _buffers[idx].
+  void submit(unsigned idx);
+  /// Reaps completions, blocking for at least min_complete of them.
+  void reap(unsigned min_complete);
+  /// Takes back the entries the kernel refused and writes their buffers
+  /// with pwrite(2) instead.
+  void write_through();
+
+  /// The file descriptor written to.
+  int _fd;
+  /// The io_uring instance.
+  std::unique_ptr<Ring> _ring;
+  /// The size of each staging buffer.
+  std::size_t _buffer_sz;
+  /// The staging buffers, registered with the ring.
+  std::vector<Buffer> _buffers;
+  /// The file offset of the next write.
+  std::uint64_t _offset;
+  /// The number of writes in flight.
+  unsigned _in_flight = 0;
+};
+
+/**
+ * @enum MsyncPolicy
+ * @brief Defines how hard MmapSink pushes written pages to disk.
+ *
+ * Pages copied into the mapping belong to the page cache as soon as the
+ * memcpy returns, so they survive the process dying whatever the policy; the
+ * policy only matters if the machine goes down.
+ *
+ * - NONE: Leave writeback to the kernel.
+ * - ON_ROLL: msync(MS_SYNC) a segment when it is closed.
+ * - ASYNC: msync(MS_ASYNC) after every batch, MS_SYNC on close.
+ * - SYNC: msync(MS_SYNC) after every batch.
+ */
+enum class MsyncPolicy : char {
+  NONE = 0,    ///< Kernel writeback only
+  ON_ROLL = 1, ///< Sync a segment when it is closed
+  ASYNC = 2,   ///< Schedule writeback after every batch
+  SYNC = 3     ///< Wait for writeback after every batch
+};
+
+/**
+ * @class MmapSink
+ * @brief Appends batches to preallocated, memory-mapped file segments.
+ *
+ * Each segment is fallocate()d to a fixed size and mapped once; write() is a
+ * plain memcpy into the mapping with no system call. When a segment is full
+ * the sink rolls over to the next one: the first segment is the file path
+ * itself, the following ones are "<path>.1", "<path>.2", ... A batch that
+ * does not fit in what is left of a segment starts the next one, and one
+ * larger than a segment is split between records, so each segment holds
+ * whole lines unless a single line is larger than a segment. Segments are
+ * truncated to the bytes actually written when they are closed. A segment left
+ * behind by a crash keeps its zero-filled tail.
+ */
+class MmapSink : public ISink {
+public:
+  /**
+   * @brief Creates the first segment.
+   *
+   * @param file_path The path of the first segment.
+   * @param segment_sz The size each segment is preallocated to. Rounded up to
+   * a multiple of the page size.
+   * @param policy When written pages are msync()ed.
+   *
+   * @throws std::runtime_error If the first segment cannot be created.
+   */
+  MmapSink(const std::string &file_path, std::size_t segment_sz,
+           MsyncPolicy policy = MsyncPolicy::ON_ROLL);
+  ~MmapSink() override;
+  MmapSink(const MmapSink &) = delete;
+  MmapSink &operator=(const MmapSink &) = delete;
+
+  /// Copies data into the mapping, rolling over segments between records as
+  /// needed, then msync()s it if the policy says so.
+  void write(std::string_view data) override;
+
+private:
+  /// Creates, preallocates and maps segment number _segment.
+  bool open_segment();
+  /// Syncs according to the policy, unmaps, trims and closes the segment.
+  void close_segment();
+
+  /// The path of the first segment.
+  const std::string _path;
+  /// The preallocated size of every segment.
+  const std::size_t _segment_sz;
+  /// When written pages are msync()ed.
+  const MsyncPolicy _policy;
+  /// The index of the current segment.
+  unsigned _segment = 0;
+  /// The current segment's file descriptor, -1 if none is open.
+  int _fd = -1;
+  /// The current segment's mapping, nullptr if none is open.
+  char *_map = nullptr;
+  /// Bytes written to the current segment.
+  std::size_t _pos = 0;
+};
+
+} // namespace Spektral::Log
@@ -0,0 +1,84 @@
+/// @file: include/SlabAllocator.hpp
+/// @brief: allocators for LogEvent payloads too large to be stored inline.
+///
+/// 1. provides class NewAllocator, which forwards to the global operator new.
+/// 2. provides class SlabAllocator, per-thread slabs whose blocks the backend
+/// hands back to the allocating thread.
+/// 3. defines LOG_PAYLOAD_ALLOCATOR, the allocator LogEvent uses.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace Spektral::Log {
+
+/**
+ * @class NewAllocator
+ * @brief Payload allocator that uses the global operator new and delete.
+ */
+class NewAllocator {
+public:
+  /// Allocates sz bytes aligned to alignof(std::max_align_t).
+  static void *allocate(std::size_t sz) { return ::operator new(sz); }
+  /// Frees memory returned by allocate(sz).
+  static void deallocate(void *ptr, std::size_t sz) noexcept {
+    ::operator delete(ptr, sz);
+  }
+};
+
+/**
+ * @struct SlabStats
+ * @brief Counters reported by SlabAllocator::stats().
+ */
+struct SlabStats {
+  /// Allocations served from a thread's free lists.
+  std::uint64_t hits;
+  /// Allocations that needed fresh memory: a block carved from a slab, a new
+  /// slab or an allocation larger than SlabAllocator::max_block.
+  std::uint64_t misses;
+};
+
+/**
+ * @class SlabAllocator
+ * @brief Payload allocator made of per-thread slabs of fixed size blocks.
+ *
+ * Each thread allocates from its own cache: one free list per size class
+ * (64 bytes to max_block, powers of two), refilled from slabs of 64KB. A
+ * block freed by the thread that allocated it goes straight back to its free
+ * list. A block freed by another thread, typically a logger's backend once it
+ * has written the event, is pushed onto a lock-free list owned by the
+ * allocating thread, which takes the whole list back in one exchange when its
+ * own free list runs dry. Once the free lists are warm, logging never calls
+ * malloc and never frees memory across threads.
+ *
+ * Slabs are never returned to the system. The cache of a thread that exits is
+ * handed to the next thread that needs one, so memory is bounded by the peak
+ * number of logging threads.
+ */
+class SlabAllocator {
+public:
+  /// Largest allocation (header included) served from slabs; larger ones go
+  /// to the global operator new.
+  static constexpr std::size_t max_block = 16384;
+
+  /// Allocates sz bytes aligned to alignof(std::max_align_t).
+  static void *allocate(std::size_t sz);
+  /// Frees memory returned by allocate(sz). Can be called from any thread.
+  static void deallocate(void *ptr, std::size_t sz) noexcept;
+  /// Hit and miss counters summed over every thread.
+  static SlabStats stats();
+};
+
+} // namespace Spektral::Log
+
+#ifndef LOG_PAYLOAD_ALLOCATOR
+/**
+ * @brief The allocator LogEvent uses for sources and messages that do not fit
+ * in LOG_INLINE_SZ bytes.
+ *
+ * Can be overridden at compile time, e.g.
+ * -DLOG_PAYLOAD_ALLOCATOR=Spektral::Log::NewAllocator
+ */
+#define LOG_PAYLOAD_ALLOCATOR ::Spektral::Log::SlabAllocator
+#endif
@@ -58,7 +58,7 @@ private:
   /**
    * @brief: val is the encapsulated value that this wrapper will hold onto.
    */
-  std::unique_ptr<T> val;
+  T val;
 
 public:
   /**
@@ -68,14 +68,13 @@ public:
    * @param args A parameter pack that will be expanded and converted into type
    * T.
    */
-  template <typename... Args> Source(Args... args) {
-    val = std::make_unique<T>(args...);
-  }
+  template <typename... Args>
+  Source(Args... args) : val(std::move(args)...) {}
 
   /**
    * @brief Convert the encapsulated value to a string when logging.
    */
-  operator std::string() override { return val->operator std::string(); }
+  operator std::string() override { return val.operator std::string(); }
   /**
    * @brief Creates and returns a pointer to a new Source object.
    *
@@ -91,7 +90,7 @@ public:
    */
   template <typename... Args>
   static std::unique_ptr<Source> Make(Args... args) {
-    return std::make_unique(args...);
+    return std::make_unique<Source>(std::move(args)...);
   }
 };
 
@@ -106,27 +105,33 @@ private:
   /**
    * @brief: val is the encapsulated value that this wrapper will hold onto.
    */
-  std::unique_ptr<std::string> val;
+  std::string val;
 
 public:
   /**
-   * @brief A copy constructor for use EXCLUSIVELY by Source<std::string>::Make;
+   * @brief A copy constructor. Pass the result to LogEvent by value to store
+   * it inline, without a heap allocation.
    *
    * @param str const std::string & The value to copy from.
    * T.
    */
-  Source(const std::string &str) { val = std::make_unique<std::string>(str); }
+  Source(const std::string &str) : val(str) {}
   /**
-   * @brief A move constructor for use EXCLUSIVELY by Source<std::string>::Make;
+   * @brief A move constructor. Pass the result to LogEvent by value to store
+   * it inline, without a heap allocation.
    *
    * @param str const std::string The value to move from.
    * T.
    */
-  Source(std::string &&str) { val = std::make_unique<std::string>(str); }
+  Source(std::string &&str) noexcept : val(std::move(str)) {}
   /**
    * @brief Convert the encapsulated value to a string when logging.
    */
-  operator std::string() override { return *val; }
+  operator std::string() override { return val; }
+  /**
+   * @brief Append the encapsulated value to out when logging.
+   */
+  void format_to(std::string &out) override { out += val; }
   /**
    * @brief Creates and returns a pointer to a new Source object.
    *
@@ -0,0 +1,258 @@
+/// @file: include/StagingQueue.hpp
+/// @brief: per-thread staging buffers that sit between the logging threads and
+/// a logger's backend thread.
+///
+/// 1. provides class ThreadLanes<Ring>, a registry of lazily created
+/// per-thread rings.
+/// 2. provides class StagingQueue<T, Ring>, per-thread SPSC lanes of T.
+
+#pragma once
+#include "RingBuffer.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace Spektral::Log {
+
+/**
+ * @class ThreadLanes
+ * @brief A set of lazily registered per-thread rings ("lanes") read by a single
+ * consumer.
+ *
+ * The first time a thread calls local() it allocates its own Ring and
+ * registers it under a mutex. Every later call from that thread finds its lane
+ * through a thread_local cache and touches no shared state at all, so the cost
+ * of producing does not grow with the number of producing threads.
+ *
+ * The consumer keeps a private snapshot of the registered lanes and only
+ * refreshes it when a new lane shows up. Lanes of threads that have exited are
+ * dropped once the consumer has emptied them.
+ *
+ * @tparam Ring A single-producer/single-consumer ring constructible from a
+ * capacity and providing a consumer side empty().
+ */
+template <typename Ring> class ThreadLanes {
+public:
+  /**
+   * @brief Constructs a registry without any lanes.
+   *
+   * @param lane_capacity The capacity of each thread's lane.
+   */
+  explicit ThreadLanes(std::size_t lane_capacity)
+      : _id(next_id()), _lane_capacity(lane_capacity) {}
+
+  ThreadLanes(const ThreadLanes &) = delete;
+  ThreadLanes &operator=(const ThreadLanes &) = delete;
+
+  /**
+   * @brief Marks every lane as orphaned so that threads still caching them
+   * release them on their next lookup.
+   */
+  ~ThreadLanes() {
+    std::lock_guard lock(_registry_mtx);
+    for (auto &lane : _lanes)
+      lane->orphaned.store(true, std::memory_order_release);
+  }
+
+  /**
+   * @brief Finds (or registers) the calling thread's lane. The caller is its
+   * only producer.
+   */
+  Ring &local() {
+    thread_local LaneCache cache;
+    for (auto &[id, lane] : cache.lanes)
+      if (id == _id)
+        return lane->ring;
+
+    std::erase_if(cache.lanes, [](const auto &entry) {
+      return entry.second->orphaned.load(std::memory_order_acquire);
+    });
+    auto lane = std::make_shared<Lane>(_lane_capacity);
+    {
+      std::lock_guard lock(_registry_mtx);
+      _lanes.push_back(lane);
+      _generation.fetch_add(1, std::memory_order_release);
+    }
+    cache.lanes.emplace_back(_id, lane);
+    return lane->ring;
+  }
+
+  /**
+   * @brief Calls f on every lane in registration order. Must only be called
+   * from the consumer thread.
+   *
+   * Lanes whose thread has exited and that are empty once f returns are
+   * forgotten.
+   *
+   * @param f Callable taking a Ring &.
+   */
+  template <typename F> void for_each(F &&f) {
+    refresh();
+    bool reap = false;
+    for (auto &lane : _snapshot) {
+      f(lane->ring);
+      reap |= lane->retired.load(std::memory_order_acquire) &&
+              lane->ring.empty();
+    }
+    if (reap)
+      reap_retired();
+  }
+
+  /**
+   * @brief Checks whether every lane is empty. Must only be called from the
+   * consumer thread.
+   */
+  bool empty() {
+    refresh();
+    for (auto &lane : _snapshot)
+      if (!lane->ring.empty())
+        return false;
+    return true;
+  }
+
+private:
+  /// A single thread's ring plus the flags used to reclaim it.
+  struct Lane {
+    explicit Lane(std::size_t capacity) : ring(capacity) {}
+    Ring ring;
+    /// Set by the owning thread when it exits.
+    std::atomic<bool> retired{false};
+    /// Set when the ThreadLanes itself is destroyed.
+    std::atomic<bool> orphaned{false};
+  };
+
+  /// A thread's cache of the lanes it owns, one per ThreadLanes it used.
+  struct LaneCache {
+    std::vector<std::pair<std::uint64_t, std::shared_ptr<Lane>>> lanes;
+    ~LaneCache() {
+      for (auto &[id, lane] : lanes)
+        lane->retired.store(true, std::memory_order_release);
+    }
+  };
+
+  /// Hands out unique ids so a thread_local cache entry can never match a
+  /// different registry that happens to reuse the same address.
+  static std::uint64_t next_id() {
+    static std::atomic<std::uint64_t> ids{0};
+    return ids.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Refreshes the consumer's snapshot if a lane was added or removed.
+  void refresh() {
+    std::size_t gen = _generation.load(std::memory_order_acquire);
+    if (gen == _seen_generation)
+      return;
+    std::lock_guard lock(_registry_mtx);
+    _snapshot = _lanes;
+    _seen_generation = _generation.load(std::memory_order_relaxed);
+  }
+
+  /// Forgets lanes whose thread has exited and that have been fully drained.
+  void reap_retired() {
+    std::lock_guard lock(_registry_mtx);
+    std::erase_if(_lanes, [](const auto &lane) {
+      return lane->retired.load(std::memory_order_acquire) &&
+             lane->ring.empty();
+    });
+    _generation.fetch_add(1, std::memory_order_release);
+  }
+
+  /// Unique id of this registry.
+  const std::uint64_t _id;
+  /// The capacity of each newly registered lane.
+  const std::size_t _lane_capacity;
+  /// Guards _lanes.
+  std::mutex _registry_mtx;
+  /// Every registered lane.
+  std::vector<std::shared_ptr<Lane>> _lanes;
+  /// Bumped whenever _lanes changes.
+  std::atomic<std::size_t> _generation{0};
+  /// The consumer's private copy of _lanes.
+  std::vector<std::shared_ptr<Lane>> _snapshot;
+  /// The value of _generation when _snapshot was taken.
+  std::size_t _seen_generation{0};
+};
+
+/**
+ * @class StagingQueue
+ * @brief Per-thread SPSC lanes of T drained by a single consumer.
+ *
+ * Each producing thread pushes into its own SpscRing (see ThreadLanes), so
+ * try_push() never contends with other producers. The consumer drains the
+ * lanes round-robin.
+ *
+ * @tparam T The element type. Must be move constructible.
+ * @tparam Ring The lane type. Default: SpscRing<T>; EvictingRing<T> adds
+ * evict().
+ */
+template <typename T, typename Ring = SpscRing<T>> class StagingQueue {
+public:
+  /**
+   * @brief Constructs a queue without any lanes.
+   *
+   * @param lane_capacity The capacity of each thread's lane. Must be a power of
+   * two. Default: LOG_LANE_SZ.
+   */
+  explicit StagingQueue(std::size_t lane_capacity = LOG_LANE_SZ)
+      : _lanes(lane_capacity) {}
+
+  /**
+   * @brief Attempts to push a value into the calling thread's lane.
+   *
+   * @param val The value to move into the lane.
+   * @return false if the lane is full, in which case val is left untouched.
+   */
+  bool try_push(T &&val) { return _lanes.local().try_push(std::move(val)); }
+
+  /**
+   * @brief Takes the oldest value out of the calling thread's lane, e.g. to
+   * make room for a newer one. Only available with EvictingRing lanes.
+   *
+   * @return The evicted value, or std::nullopt if the consumer took it first.
+   */
+  std::optional<T> evict()
+    requires requires(Ring &ring) { ring.evict(); }
+  {
+    return _lanes.local().evict();
+  }
+
+  /**
+   * @brief Pops values from every lane in round-robin order. Must only be
+   * called from the consumer thread.
+   *
+   * @param f Callable invoked with every popped value as an rvalue.
+   * @param max_per_lane The maximum number of values taken from a single lane,
+   * so that one busy thread cannot starve the others.
+   * @return The number of values popped.
+   */
+  template <typename F>
+  std::size_t drain(F &&f, std::size_t max_per_lane = 256) {
+    std::size_t count = 0;
+    _lanes.for_each([&](Ring &ring) {
+      for (std::size_t ii = 0; ii < max_per_lane; ++ii) {
+        auto val = ring.try_pop();
+        if (!val)
+          break;
+        f(std::move(*val));
+        ++count;
+      }
+    });
+    return count;
+  }
+
+  /**
+   * @brief Checks whether every lane is empty. Must only be called from the
+   * consumer thread.
+   */
+  bool empty() { return _lanes.empty(); }
+
+private:
+  /// One Ring per producing thread.
+  ThreadLanes<Ring> _lanes;
+};
+
+} // namespace Spektral::Log
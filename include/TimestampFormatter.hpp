@@ -0,0 +1,166 @@
+/// @file: include/TimestampFormatter.hpp
+/// @brief: renders event timestamps without redoing calendar math per event.
+///
+/// 1. defines the TimestampFormat and TimestampPrecision enums.
+/// 2. provides class TimestampFormatter, which caches the rendered date and
+/// time of day of the last second it saw.
+
+#pragma once
+#include "LogEvent.hpp"
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <string>
+
+namespace Spektral::Log {
+
+/**
+ * @enum TimestampFormat
+ * @brief Defines how a timestamp is written. Times are in UTC.
+ *
+ * - DEFAULT: "2024-05-01 13:37:00.123456789", what std::format("{}", time)
+ *   writes.
+ * - ISO8601: "2024-05-01T13:37:00.123456789Z".
+ * - EPOCH_NS: Nanoseconds since the epoch, e.g. "1714570620123456789". The
+ *   precision does not apply.
+ */
+enum class TimestampFormat : char {
+  DEFAULT = 0,  ///< std::format's "%F %T"
+  ISO8601 = 1,  ///< "%FT%TZ"
+  EPOCH_NS = 2, ///< Integer nanoseconds since the epoch
+};
+
+/**
+ * @enum TimestampPrecision
+ * @brief Defines how many fractional digits of the second are written. The
+ * value is the number of digits; the fraction is truncated, not rounded.
+ */
+enum class TimestampPrecision : char {
+  SECONDS = 0, ///< No fraction
+  MILLIS = 3,  ///< 3 digits
+  MICROS = 6,  ///< 6 digits
+  NANOS = 9    ///< 9 digits
+};
+
+/**
+ * @class TimestampFormatter
+ * @brief Appends timestamps to a string, caching everything up to the
+ * seconds.
+ *
+ * The date, hour and minute are rendered when the minute changes and the
+ * seconds when the second changes; every other timestamp only costs its
+ * fractional digits. Events are formatted in (mostly) increasing time order,
+ * so the cache almost always hits.
+ *
+ * Not thread-safe: each backend thread uses its own.
+ */
+class TimestampFormatter {
+public:
+  /**
+   * @brief Constructs a TimestampFormatter.
+   *
+   * @param format How timestamps are written. Default: DEFAULT.
+   * @param precision How many fractional digits are written. Default: NANOS.
+   */
+  explicit TimestampFormatter(TimestampFormat format = TimestampFormat::DEFAULT,
+                              TimestampPrecision precision =
+                                  TimestampPrecision::NANOS)
+      : _format(format), _precision(precision) {}
+
+  /**
+   * @brief Appends time to out.
+   *
+   * @param out The string to append to.
+   * @param time The timestamp.
+   */
+  void format_to(std::string &out, std_time_t time) {
+    std::int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          time.time_since_epoch())
+                          .count();
+    if (_format == TimestampFormat::EPOCH_NS) {
+      char buf[24];
+      auto res = std::to_chars(buf, buf + sizeof(buf), ns);
+      out.append(buf, res.ptr);
+      return;
+    }
+
+    std::int64_t second = floor_div(ns, ns_per_second);
+    if (second != _second)
+      refresh(second);
+    out += _cached;
+
+    if (auto digits = static_cast<int>(_precision)) {
+      auto frac = static_cast<std::uint32_t>(ns - second * ns_per_second);
+      char buf[10];
+      buf[0] = '.';
+      for (int ii = 9; ii > 0; --ii, frac /= 10)
+        buf[ii] = static_cast<char>('0' + frac % 10);
+      out.append(buf, 1 + digits);
+    }
+    if (_format == TimestampFormat::ISO8601)
+      out += 'Z';
+  }
+
+  /**
+   * @brief Formats time.
+   *
+   * @param time The timestamp.
+   * @return The rendered timestamp.
+   */
+  std::string format(std_time_t time) {
+    std::string out;
+    format_to(out, time);
+    return out;
+  }
+
+private:
+  static constexpr std::int64_t ns_per_second = 1'000'000'000;
+
+  /// Division rounding towards negative infinity, for times before 1970.
+  static constexpr std::int64_t floor_div(std::int64_t num, std::int64_t den) {
+    std::int64_t quot = num / den;
+    return quot - (num % den < 0);
+  }
+
+  /// Renders the cached prefix for second, reusing the date and time of day
+  /// up to the minute when only the second changed.
+  void refresh(std::int64_t second) {
+    using namespace std::chrono;
+    std::int64_t minute = floor_div(second, 60);
+    if (minute != _minute) {
+      sys_seconds start{seconds(minute * 60)};
+      auto day = floor<days>(start);
+      year_month_day ymd(day);
+      hh_mm_ss hms(start - day);
+      _cached = std::format(
+          "{:04}-{:02}-{:02}{}{:02}:{:02}:", static_cast<int>(ymd.year()),
+          static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()),
+          _format == TimestampFormat::ISO8601 ? 'T' : ' ',
+          hms.hours().count(), hms.minutes().count());
+      _minute_len = _cached.size();
+      _minute = minute;
+    }
+    auto sec = static_cast<unsigned>(second - minute * 60);
+    _cached.resize(_minute_len);
+    _cached += static_cast<char>('0' + sec / 10);
+    _cached += static_cast<char>('0' + sec % 10);
+    _second = second;
+  }
+
+  /// How timestamps are written.
+  TimestampFormat _format;
+  /// How many fractional digits are written.
+  TimestampPrecision _precision;
+  /// The second _cached renders.
+  std::int64_t _second = std::numeric_limits<std::int64_t>::min();
+  /// The minute the first _minute_len bytes of _cached render.
+  std::int64_t _minute = std::numeric_limits<std::int64_t>::min();
+  /// The length of the prefix up to and including the minutes.
+  std::size_t _minute_len = 0;
+  /// The rendered timestamp up to and including the seconds.
+  std::string _cached;
+};
+
+} // namespace Spektral::Log
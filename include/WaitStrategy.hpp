@@ -0,0 +1,195 @@
+/// @file: include/WaitStrategy.hpp
+/// @brief: how a backend thread waits for work once its queues run dry.
+///
+/// 1. defines the WaitStrategy enum, selectable per logger.
+/// 2. provides class Waiter, which implements each strategy for a single
+/// consumer and lets producers wake it up.
+
+#pragma once
+#include "RingBuffer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__linux__)
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Spektral::Log {
+
+/**
+ * @enum WaitStrategy
+ * @brief Defines what a backend thread does when it finds nothing to log.
+ *
+ * - BUSY_SPIN: Keep polling. Lowest latency, burns a full core.
+ * - SPIN_YIELD: Poll for a while, then std::this_thread::yield() between
+ *   polls.
+ * - PARK: Poll for a while, then sleep on a futex (std::atomic::wait
+ *   elsewhere than on Linux) until a producer wakes it up.
+ * - TIMED: Sleep for a fixed period between polls.
+ */
+enum class WaitStrategy : char {
+  BUSY_SPIN = 0,  ///< Spin on the queues
+  SPIN_YIELD = 1, ///< Spin, then yield the core
+  PARK = 2,       ///< Spin, then park until notified
+  TIMED = 3       ///< Sleep a fixed period between polls
+};
+
+/**
+ * @class Waiter
+ * @brief Implements a WaitStrategy for a single consumer thread.
+ *
+ * The consumer calls wait() every time a pass over its queues came back empty
+ * and reset() every time it found work. Producers call notify() after
+ * publishing an event; notify() only issues the futex wake-up when the
+ * consumer is actually parked, so with any strategy other than PARK (or while
+ * the consumer is busy) it costs a fence and a load of a read-shared flag.
+ */
+class Waiter {
+public:
+  /// The clock of wait()'s deadlines.
+  using steady = std::chrono::steady_clock;
+
+  /**
+   * @brief Constructs a Waiter.
+   *
+   * @param strategy The WaitStrategy to use. Default: PARK.
+   * @param period How long TIMED sleeps between polls. Default: 1ms.
+   */
+  explicit Waiter(WaitStrategy strategy = WaitStrategy::PARK,
+                  std::chrono::microseconds period = std::chrono::milliseconds(1))
+      : _strategy(strategy), _period(period) {}
+
+  /**
+   * @brief Waits according to the strategy. Must only be called from the
+   * consumer thread.
+   *
+   * @param has_work Predicate re-checked after announcing that the consumer is
+   * about to park, so that a wake-up racing with the decision to park is never
+   * lost. It should also return true once the consumer has been asked to stop.
+   * @param deadline When to return at the latest, e.g. when a timer is due.
+   * Default: never.
+   */
+  template <typename F>
+  void wait(F &&has_work,
+            steady::time_point deadline = steady::time_point::max()) {
+    using enum WaitStrategy;
+    switch (_strategy) {
+    case BUSY_SPIN:
+      cpu_relax();
+      return;
+    case SPIN_YIELD:
+      if (++_idle_polls < spin_polls)
+        cpu_relax();
+      else
+        std::this_thread::yield();
+      return;
+    case TIMED:
+      std::this_thread::sleep_for(
+          std::min<steady::duration>(_period, deadline - steady::now()));
+      return;
+    case PARK:
+      if (++_idle_polls < spin_polls) {
+        cpu_relax();
+        return;
+      }
+      std::uint32_t epoch = _epoch.load(std::memory_order_acquire);
+      _parked.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!has_work())
+        park(epoch, deadline);
+      _parked.store(false, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  /**
+   * @brief Tells the Waiter the consumer found work, restarting the spin phase.
+   * Must only be called from the consumer thread.
+   */
+  void reset() { _idle_polls = 0; }
+
+  /**
+   * @brief Wakes the consumer if it is parked. Call after publishing an event.
+   */
+  void notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_parked.load(std::memory_order_relaxed))
+      wake();
+  }
+
+  /**
+   * @brief Unconditionally wakes the consumer, e.g. when asking it to stop.
+   */
+  void wake() {
+    _epoch.fetch_add(1, std::memory_order_release);
+#if defined(__linux__)
+    ::syscall(SYS_futex, &_epoch, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    _epoch.notify_one();
+#endif
+  }
+
+  /// The strategy this Waiter implements.
+  WaitStrategy strategy() const { return _strategy; }
+
+private:
+  /// The number of empty polls PARK and SPIN_YIELD spin for before backing off.
+  static constexpr unsigned spin_polls = 1024;
+
+  /// Hints the core that we are in a spin loop.
+  static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+  }
+
+  /// Sleeps until _epoch moves on from epoch or deadline passes; may return
+  /// early. On Linux a futex with a timeout, which std::atomic::wait lacks.
+  void park(std::uint32_t epoch, steady::time_point deadline) {
+    bool timed = deadline != steady::time_point::max();
+#if defined(__linux__)
+    timespec timeout{};
+    if (timed) {
+      auto left = deadline - steady::now();
+      if (left <= steady::duration::zero())
+        return;
+      auto secs = std::chrono::duration_cast<std::chrono::seconds>(left);
+      timeout.tv_sec = static_cast<std::time_t>(secs.count());
+      timeout.tv_nsec = static_cast<long>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(left - secs)
+              .count());
+    }
+    ::syscall(SYS_futex, &_epoch, FUTEX_WAIT_PRIVATE, epoch,
+              timed ? &timeout : nullptr, nullptr, 0);
+#else
+    if (!timed) {
+      _epoch.wait(epoch, std::memory_order_acquire);
+      return;
+    }
+    while (_epoch.load(std::memory_order_acquire) == epoch &&
+           steady::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+  }
+
+  /// The strategy in use.
+  const WaitStrategy _strategy;
+  /// Sleep period used by TIMED.
+  const std::chrono::microseconds _period;
+  /// Empty polls since the consumer last found work.
+  unsigned _idle_polls = 0;
+  /// Futex word the consumer parks on, bumped by wake().
+  alignas(cache_line_sz) std::atomic<std::uint32_t> _epoch{0};
+  /// Whether the consumer is (about to be) parked.
+  std::atomic<bool> _parked{false};
+};
+
+} // namespace Spektral::Log
@@ -0,0 +1,165 @@
+#include "BinaryLogger.hpp"
+#include "LogCustomErrors.hpp"
+#include <fcntl.h>
+#include <format>
+#include <forward_list>
+#include <mutex>
+#include <unordered_map>
+
+namespace Spektral::Log {
+
+namespace {
+/// An EVENTS chunk is written once its payload reaches this size.
+constexpr std::size_t chunk_bytes = 1 << 16;
+
+/// The process-wide format string dictionary.
+struct FormatRegistry {
+  std::mutex mtx;
+  /// Literals point to static storage, other strings into owned.
+  std::unordered_map<std::uint64_t, std::string_view> formats;
+  /// Copies of the format strings registered at runtime.
+  std::forward_list<std::string> owned;
+};
+
+FormatRegistry &registry() {
+  static FormatRegistry reg;
+  return reg;
+}
+
+/// Appends the raw bytes of val to out.
+template <typename T> void append(std::string &out, const T &val) {
+  out.append(reinterpret_cast<const char *>(&val), sizeof(val));
+}
+
+/// Appends a chunk of the given type to out.
+void append_chunk(std::string &out, Binary::ChunkType type,
+                  std::string_view payload, std::uint32_t records) {
+  Binary::ChunkHeader hdr{Binary::chunk_magic, type, {},
+                          static_cast<std::uint32_t>(payload.size()), records};
+  append(out, hdr);
+  out += payload;
+}
+
+/// Creates the file and writes its header.
+std::unique_ptr<ISink> open_sink(const std::string &file_path) {
+  int fd = ::open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+  if (fd < 0)
+    throw std::runtime_error(std::format("Failed to open file: {}", file_path));
+  auto sink = std::make_unique<FdSink>(fd);
+  Binary::FileHeader hdr{{}, Binary::format_version, 0};
+  std::memcpy(hdr.magic, Binary::file_magic, sizeof(hdr.magic));
+  sink->write({reinterpret_cast<const char *>(&hdr), sizeof(hdr)});
+  return sink;
+}
+} // namespace
+
+BinaryLogger::BinaryLogger(const std::string &file_path, WaitStrategy wait,
+                           ClockSource clock)
+    : _clock(clock), _sink(open_sink(file_path)), _lanes(LOG_BINARY_LANE_SZ),
+      _can_continue(true), _waiter(wait) {
+  _ref = start_backend(_can_continue);
+}
+
+BinaryLogger::~BinaryLogger() {
+  _can_continue = false;
+  _waiter.wake();
+  _ref.get();
+}
+
+std::uint64_t BinaryLogger::register_format(std::string_view fmt) {
+  std::uint64_t id = Binary::format_id(fmt);
+  FormatRegistry &reg = registry();
+  std::lock_guard lock(reg.mtx);
+  if (!reg.formats.contains(id))
+    reg.formats.emplace(id, reg.owned.emplace_front(fmt));
+  return id;
+}
+
+bool BinaryLogger::register_static(std::uint64_t id, std::string_view fmt) {
+  FormatRegistry &reg = registry();
+  std::lock_guard lock(reg.mtx);
+  reg.formats.try_emplace(id, fmt);
+  return true;
+}
+
+void BinaryLogger::throw_full(LogLevel level) {
+  throw full_queue_exception(level);
+}
+
+std::future<void> BinaryLogger::start_backend(std::atomic<bool> &can_continue) {
+  return std::async(std::launch::async, [this, &can_continue]() -> void {
+    std::string events, dict, out;
+    std::uint32_t event_count = 0, dict_count = 0;
+    events.reserve(2 * chunk_bytes);
+
+    // Writes the pending events as one chunk, preceded by a DICT chunk for
+    // the format strings they introduce.
+    auto write_chunk = [&]() {
+      if (!event_count)
+        return;
+      out.clear();
+      if (dict_count)
+        append_chunk(out, Binary::ChunkType::DICT, dict, dict_count);
+      append_chunk(out, Binary::ChunkType::EVENTS, events, event_count);
+      _sink->write(out);
+      events.clear();
+      dict.clear();
+      event_count = dict_count = 0;
+    };
+
+    // Adds the DICT record for id unless it is already in the file.
+    auto add_format = [&](std::uint64_t id) {
+      if (!_written_formats.insert(id).second)
+        return;
+      FormatRegistry &reg = registry();
+      std::lock_guard lock(reg.mtx);
+      auto it = reg.formats.find(id);
+      // An id nobody registered still gets a record so that the decoder can
+      // tell it apart from a corrupt file.
+      std::string_view fmt =
+          it == reg.formats.end() ? std::string_view() : it->second;
+      append(dict, id);
+      append(dict, static_cast<std::uint32_t>(fmt.size()));
+      dict += fmt;
+      ++dict_count;
+    };
+
+    // Moves every committed record into the current chunk. Returns whether
+    // anything was drained.
+    auto drain = [&]() -> bool {
+      bool drained = false;
+      _lanes.for_each([&](SpscByteRing &lane) {
+        std::string_view rec;
+        while (lane.peek(rec)) {
+          Binary::EventHeader hdr;
+          std::memcpy(&hdr, rec.data(), sizeof(hdr));
+          add_format(hdr.fmt_id);
+          append(events, static_cast<std::uint32_t>(rec.size()));
+          events += rec;
+          ++event_count;
+          lane.pop();
+          drained = true;
+          if (events.size() >= chunk_bytes)
+            write_chunk();
+        }
+      });
+      write_chunk();
+      return drained;
+    };
+
+    while (can_continue) {
+      if (drain()) {
+        _waiter.reset();
+      } else {
+        _waiter.wait([this, &can_continue]() {
+          return !can_continue || !_lanes.empty();
+        });
+      }
+    }
+
+    while (drain())
+      ;
+  });
+}
+} // namespace Spektral::Log
@@ -0,0 +1,142 @@
+#include "Clock.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace Spektral::Log {
+
+namespace {
+using steady = std::chrono::steady_clock;
+
+/// How long the first calibration measures before the Clock is usable.
+constexpr auto first_period = std::chrono::milliseconds(10);
+/// The calibration period doubles from first_period up to this.
+constexpr auto max_period = std::chrono::seconds(1);
+/// How much slower than the steady clock TSC time may run while the system
+/// clock, which went back, catches up with it: 500ppm, as adjtime(3).
+constexpr double max_slew = 500e-6;
+
+/// Nanoseconds since the epoch of tp's clock.
+template <typename TimePoint> std::int64_t ns_of(TimePoint tp) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             tp.time_since_epoch())
+      .count();
+}
+
+/// A reading of the counter and of the steady and system clocks.
+struct Sample {
+  std::int64_t tsc;
+  std::int64_t steady_ns;
+  std::int64_t wall_ns;
+};
+} // namespace
+
+Clock::Clock(ClockSource source) : _source(source) {
+  if (_source == ClockSource::TSC && !tsc_available())
+    _source = ClockSource::SYSTEM;
+  if (_source == ClockSource::TSC)
+    start_calibration();
+  if (_source == ClockSource::STEADY)
+    _steady_offset = std_clock::now().time_since_epoch() -
+                     std::chrono::duration_cast<std_clock::duration>(
+                         steady::now().time_since_epoch());
+}
+
+bool Clock::tsc_available() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  // CPUID.80000007H:EDX[8]: the TSC ticks at a constant rate in every P-, C-
+  // and T-state.
+  static const bool available = [] {
+    unsigned eax, ebx, ecx, edx;
+    return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) &&
+           (edx & (1u << 8));
+  }();
+  return available;
+#else
+  return false;
+#endif
+}
+
+void Clock::start_calibration() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    // Keeps the tightest of a few readings so that being preempted between
+    // the reads does not skew the sample.
+    auto sample = []() -> Sample {
+      Sample best{};
+      std::int64_t best_gap = std::numeric_limits<std::int64_t>::max();
+      for (int i = 0; i < 5; ++i) {
+        std::int64_t before = rdtsc();
+        auto steady_now = steady::now();
+        auto wall_now = std_clock::now();
+        std::int64_t gap = rdtsc() - before;
+        if (gap < best_gap) {
+          best_gap = gap;
+          best = {before + gap / 2, ns_of(steady_now), ns_of(wall_now)};
+        }
+      }
+      return best;
+    };
+
+    // The scale is measured against the steady clock over everything since
+    // the first sample, so that it converges and adjustments of the system
+    // clock do not bend it; the base follows the system clock, but never
+    // backwards. When the time published so far is ahead of the system clock,
+    // it carries on from there and runs up to max_slew slower, so that the
+    // system clock catches up within max_period or so.
+    auto publish = [](const Sample &first, const Sample &last) {
+      double ns_per_tick = static_cast<double>(last.steady_ns - first.steady_ns) /
+                           static_cast<double>(last.tsc - first.tsc);
+      std::uint32_t seq = _tsc.seq.load(std::memory_order_relaxed);
+      std::int64_t ns_base = last.wall_ns;
+      if (seq != 0) {
+        // What tsc_now() returns at last.tsc so far, computed the same way.
+        std::int64_t published =
+            _tsc.ns_base.load(std::memory_order_relaxed) +
+            static_cast<std::int64_t>(
+                static_cast<double>(
+                    last.tsc - _tsc.tsc_base.load(std::memory_order_relaxed)) *
+                _tsc.ns_per_tick.load(std::memory_order_relaxed));
+        if (published > ns_base) {
+          double ahead = static_cast<double>(published - ns_base) /
+                         static_cast<double>(
+                             std::chrono::nanoseconds(max_period).count());
+          ns_per_tick *= 1 - std::min(ahead, max_slew);
+          ns_base = published;
+        }
+      }
+      _tsc.seq.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      _tsc.tsc_base.store(last.tsc, std::memory_order_relaxed);
+      _tsc.ns_base.store(ns_base, std::memory_order_relaxed);
+      _tsc.ns_per_tick.store(ns_per_tick, std::memory_order_relaxed);
+      _tsc.seq.store(seq + 2, std::memory_order_release);
+    };
+
+    Sample first = sample();
+    std::this_thread::sleep_for(first_period);
+    publish(first, sample());
+
+    static std::jthread calibrator([first, sample,
+                                    publish](std::stop_token stop) {
+      std::mutex mtx;
+      std::condition_variable_any cv;
+      std::unique_lock lock(mtx);
+      auto period = std::chrono::duration_cast<std::chrono::milliseconds>(
+          2 * first_period);
+      while (!cv.wait_for(lock, stop, period,
+                          [&stop] { return stop.stop_requested(); })) {
+        publish(first, sample());
+        period = std::min<std::chrono::milliseconds>(2 * period, max_period);
+      }
+    });
+  });
+}
+
+} // namespace Spektral::Log
@@ -0,0 +1,206 @@
+#include "Compressor.hpp"
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define SPEKTRAL_LOG_HAS_ZSTD 1
+#else
+#define SPEKTRAL_LOG_HAS_ZSTD 0
+#endif
+
+#if __has_include(<lz4frame.h>)
+#include <lz4frame.h>
+#define SPEKTRAL_LOG_HAS_LZ4 1
+#else
+#define SPEKTRAL_LOG_HAS_LZ4 0
+#endif
+
+namespace Spektral::Log {
+
+namespace {
+/// Reports an error of the compression thread, which has no caller to throw
+/// to. Unused when neither codec is available.
+[[maybe_unused]] void report(std::string_view codec, std::string_view what) {
+  std::cerr << std::format("Spektral::Log: {} compression failed: {}\n",
+                           codec, what);
+}
+} // namespace
+
+bool Compressor::available(Compression codec) noexcept {
+  switch (codec) {
+  case Compression::ZSTD:
+    return SPEKTRAL_LOG_HAS_ZSTD;
+  case Compression::LZ4:
+    return SPEKTRAL_LOG_HAS_LZ4;
+  default:
+    return false;
+  }
+}
+
+Compressor::Compressor(Compression codec, int level, std::size_t frame_bytes)
+    : _codec(codec), _level(level), _frame_bytes(frame_bytes) {
+  if (!available(codec))
+    throw std::invalid_argument(
+        "Spektral::Log was built without this compression codec");
+#if SPEKTRAL_LOG_HAS_ZSTD
+  if (codec == Compression::ZSTD) {
+    ZSTD_CCtx *ctx = ZSTD_createCCtx();
+    if (!ctx)
+      throw std::bad_alloc();
+    ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, level);
+    ZSTD_CCtx_setParameter(ctx, ZSTD_c_checksumFlag, 1);
+    _ctx = ctx;
+  }
+#endif
+#if SPEKTRAL_LOG_HAS_LZ4
+  if (codec == Compression::LZ4) {
+    LZ4F_cctx *ctx = nullptr;
+    if (LZ4F_isError(LZ4F_createCompressionContext(&ctx, LZ4F_VERSION)))
+      throw std::bad_alloc();
+    _ctx = ctx;
+  }
+#endif
+  _thread = std::jthread([this] { run(); });
+}
+
+Compressor::~Compressor() {
+  end_frame();
+  _state.store(STOP, std::memory_order_release);
+  _state.notify_all();
+  _thread.join();
+#if SPEKTRAL_LOG_HAS_ZSTD
+  if (_codec == Compression::ZSTD)
+    ZSTD_freeCCtx(static_cast<ZSTD_CCtx *>(_ctx));
+#endif
+#if SPEKTRAL_LOG_HAS_LZ4
+  if (_codec == Compression::LZ4)
+    LZ4F_freeCompressionContext(static_cast<LZ4F_cctx *>(_ctx));
+#endif
+}
+
+void Compressor::submit(std::string &batch, ISink &sink) {
+  wait();
+  _input.swap(batch);
+  batch.clear();
+  _sink = &sink;
+  _state.store(BUSY, std::memory_order_release);
+  _state.notify_all();
+}
+
+void Compressor::wait() {
+  std::uint32_t state;
+  while ((state = _state.load(std::memory_order_acquire)) == BUSY)
+    _state.wait(state, std::memory_order_acquire);
+}
+
+void Compressor::end_frame() {
+  wait();
+  if (!_frame_open)
+    return;
+  // An empty batch into the sink of the last one.
+  _input.clear();
+  _end = true;
+  _state.store(BUSY, std::memory_order_release);
+  _state.notify_all();
+  wait();
+  _end = false;
+}
+
+void Compressor::run() {
+  for (;;) {
+    _state.wait(IDLE, std::memory_order_acquire);
+    if (_state.load(std::memory_order_acquire) == STOP)
+      return;
+    if (std::size_t size = compress()) {
+      _sink->write(std::string_view(_frame.data(), size));
+      _written.fetch_add(size, std::memory_order_relaxed);
+    }
+    _state.store(IDLE, std::memory_order_release);
+    _state.notify_all();
+  }
+}
+
+std::size_t Compressor::compress() {
+  bool end = _end || _frame_in + _input.size() >= _frame_bytes;
+  std::size_t size = 0;
+  bool failed = false;
+#if SPEKTRAL_LOG_HAS_ZSTD
+  if (_codec == Compression::ZSTD) {
+    auto *ctx = static_cast<ZSTD_CCtx *>(_ctx);
+    std::size_t bound =
+        ZSTD_compressBound(_input.size()) + ZSTD_CStreamOutSize();
+    if (_frame.size() < bound)
+      _frame.resize(bound);
+    // Flushes the blocks of this batch, or ends the frame; either returns 0
+    // once everything is out.
+    ZSTD_inBuffer in{_input.data(), _input.size(), 0};
+    std::size_t left;
+    do {
+      if (_frame.size() - size < ZSTD_CStreamOutSize())
+        _frame.resize(size + ZSTD_CStreamOutSize());
+      ZSTD_outBuffer out{_frame.data(), _frame.size(), size};
+      left = ZSTD_compressStream2(ctx, &out, &in,
+                                  end ? ZSTD_e_end : ZSTD_e_flush);
+      size = out.pos;
+    } while (!ZSTD_isError(left) && left != 0);
+    if (ZSTD_isError(left)) {
+      report("zstd", ZSTD_getErrorName(left));
+      ZSTD_CCtx_reset(ctx, ZSTD_reset_session_only);
+      failed = true;
+    }
+  }
+#endif
+#if SPEKTRAL_LOG_HAS_LZ4
+  if (_codec == Compression::LZ4) {
+    auto *ctx = static_cast<LZ4F_cctx *>(_ctx);
+    LZ4F_preferences_t prefs{};
+    prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+    prefs.compressionLevel = _level;
+    // Every update is written out as blocks, linked to the earlier ones.
+    prefs.autoFlush = 1;
+    std::size_t bound = LZ4F_HEADER_SIZE_MAX +
+                        LZ4F_compressBound(_input.size(), &prefs) +
+                        LZ4F_compressBound(0, &prefs);
+    if (_frame.size() < bound)
+      _frame.resize(bound);
+    std::size_t res = 0;
+    if (!_frame_open) {
+      // Header; begins a new frame even after a failed one.
+      res = LZ4F_compressBegin(ctx, _frame.data(), _frame.size(), &prefs);
+      if (!LZ4F_isError(res))
+        size = res;
+    }
+    if (!LZ4F_isError(res) && !_input.empty()) {
+      res = LZ4F_compressUpdate(ctx, _frame.data() + size,
+                                _frame.size() - size, _input.data(),
+                                _input.size(), nullptr);
+      if (!LZ4F_isError(res))
+        size += res;
+    }
+    if (!LZ4F_isError(res) && end) {
+      // End mark and checksum.
+      res = LZ4F_compressEnd(ctx, _frame.data() + size, _frame.size() - size,
+                             nullptr);
+      if (!LZ4F_isError(res))
+        size += res;
+    }
+    if (LZ4F_isError(res)) {
+      report("lz4", LZ4F_getErrorName(res));
+      failed = true;
+    }
+  }
+#endif
+  if (failed || end) {
+    _frame_open = false;
+    _frame_in = 0;
+  } else {
+    _frame_open = true;
+    _frame_in += _input.size();
+  }
+  return failed ? 0 : size;
+}
+
+} // namespace Spektral::Log
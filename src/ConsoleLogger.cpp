@@ -1,82 +1,133 @@
 #include "ConsoleLogger.hpp"
-#include "LogCustomErrors.hpp"
+#include <algorithm>
 #include <cmath>
-#include <iostream>
-#define LOG_MAX_SZ 100000000
+#include <unistd.h>
 
 namespace Spektral::Log {
-ConsoleLogger *ConsoleLogger::inst = nullptr;
-
-ConsoleLogger::ConsoleLogger(LogLevel min_level) : _min_level(min_level) {
+ConsoleLogger::ConsoleLogger(LogLevel min_level, WaitStrategy wait,
+                             ClockSource clock, OverflowPolicy overflow,
+                             OutputFormat format)
+    : _log(overflow), _stdout_sink(STDOUT_FILENO, false),
+      _stderr_sink(STDERR_FILENO, false), _can_continue(true), _waiter(wait),
+      _min_level(min_level), _clock(clock), _format(format) {
   _ref = start_backend(_can_continue);
 }
 
 ConsoleLogger::~ConsoleLogger() {
   _can_continue = false;
+  _waiter.wake();
   _ref.get();
-  _stdout_log.clear();
-  _stderr_log.clear();
-  inst = nullptr;
 }
 
-ConsoleLogger &ConsoleLogger::get_inst(LogLevel min_level) {
-  if (!inst)
-    inst = new ConsoleLogger(min_level);
-  return *inst;
+ConsoleLogger &ConsoleLogger::get_inst(LogLevel min_level, WaitStrategy wait,
+                                       ClockSource clock,
+                                       OverflowPolicy overflow,
+                                       OutputFormat format) {
+  static ConsoleLogger inst(min_level, wait, clock, overflow, format);
+  return inst;
 }
 
 void ConsoleLogger::insert(LogEvent &&l) {
-  if (l.level < _min_level) return;
-  switch (l.level) {
-  case INFO:
-  case WARN:
-  case DEBUG:
-    _stdout_log.emplace_back(std::make_shared<LogEvent>(std::move(l)));
-    break;
-  case ERROR:
-  default:
-    _stderr_log.emplace_back(std::make_shared<LogEvent>(std::move(l)));
-    break;
-  }
+  if (l.level < _min_level)
+    return;
+  l.seq = _seq.fetch_add(1, std::memory_order_relaxed);
+  if (_log.push(std::move(l), _waiter))
+    _waiter.notify();
+}
+
+void ConsoleLogger::emplace(LogLevel level, Payload<ISource> source,
+                            Payload<IMessage> message) {
+  if (level < _min_level)
+    return;
+  insert(LogEvent(level, _clock.now(), std::move(source), std::move(message)));
 }
 
 std::future<void>
 ConsoleLogger::start_backend(std::atomic<bool> &can_continue) {
   return std::async(std::launch::async, [this, &can_continue]() -> void {
-    std::vector<log_t *> logs = {&_stdout_log, &_stderr_log};
-    while (can_continue) {
-      if (!_stdout_log.empty()) {
-        auto &front = _stdout_log.front();
-        if (front) {
-          std::cout << front->operator std::string();
+    // Holds a round of whole lanes; grown by bursts, shrunk when they end.
+    std::vector<LogEvent> batch;
+    batch.reserve(LOG_LANE_SZ);
+    std::string out_buffer, err_buffer;
+    out_buffer.reserve(batch_bytes);
+    Encoder encoder(_format);
+    auto write = [](FdSink &sink, std::string &buffer) {
+      if (buffer.empty())
+        return;
+      sink.write(buffer);
+      buffer.clear();
+    };
+    // Drains one round of every thread's lane and writes, in sequence order,
+    // the events stamped before the round started. The others may have been
+    // stamped after an earlier one whose lane was already visited, so they are
+    // held for the next round. Each stream's buffer is written before the
+    // other one is appended to, so the two streams interleave as the events
+    // did. Standard output is otherwise written once the queue is empty or the
+    // buffer is full, so a busy backend issues a few large writes; standard
+    // error every round, so errors show up right away. Neither buffer grows
+    // past batch_bytes by more than an event. Returns whether anything was
+    // drained or is held.
+    auto drain = [&]() -> bool {
+      std::uint32_t end = _seq.load(std::memory_order_relaxed);
+      _log.drain(
+          [&batch](LogEvent &&event) { batch.push_back(std::move(event)); },
+          LOG_LANE_SZ);
+      if (batch.empty())
+        return false;
+      std::sort(batch.begin(), batch.end(),
+                [](const auto &lhs, const auto &rhs) {
+                  return static_cast<std::int32_t>(lhs.seq - rhs.seq) < 0;
+                });
+      auto held = std::partition_point(
+          batch.begin(), batch.end(), [end](const LogEvent &event) {
+            return static_cast<std::int32_t>(event.seq - end) < 0;
+          });
+      for (auto it = batch.begin(); it != held; ++it) {
+        switch (it->level) {
+        case INFO:
+        case WARN:
+        case DEBUG:
+          write(_stderr_sink, err_buffer);
+          encoder.encode(out_buffer, *it);
+          if (out_buffer.size() >= batch_bytes)
+            write(_stdout_sink, out_buffer);
+          break;
+        case ERROR:
+        default:
+          write(_stdout_sink, out_buffer);
+          encoder.encode(err_buffer, *it);
+          if (err_buffer.size() >= batch_bytes)
+            write(_stderr_sink, err_buffer);
+          break;
         }
-        _stdout_log.pop_front();
       }
-      if (!_stderr_log.empty()) {
-        auto &front = _stderr_log.front();
-        if (front) {
-          std::cerr << front->operator std::string();
-        }
-        _stderr_log.pop_front();
+      batch.erase(batch.begin(), held);
+      if (batch.empty() && batch.capacity() > 4 * LOG_LANE_SZ) {
+        std::vector<LogEvent>().swap(batch);
+        batch.reserve(LOG_LANE_SZ);
       }
-    }
-
-    while (!_stdout_log.empty() || !_stderr_log.empty()) {
-      if (!_stdout_log.empty()) {
-        auto &front = _stdout_log.front();
-        if (front) {
-          std::cout << front->operator std::string();
-        }
-        _stdout_log.pop_front();
-      }
-      if (!_stderr_log.empty()) {
-        auto &front = _stderr_log.front();
-        if (front) {
-          std::cerr << front->operator std::string();
-        }
-        _stderr_log.pop_front();
+      if (auto report = _log.report_dropped()) {
+        write(_stderr_sink, err_buffer);
+        encoder.encode(out_buffer, *report);
       }
+      write(_stderr_sink, err_buffer);
+      if (out_buffer.size() >= batch_bytes || (batch.empty() && _log.empty()))
+        write(_stdout_sink, out_buffer);
+      return true;
+    };
+
+    while (can_continue) {
+      if (drain())
+        _waiter.reset();
+      else
+        _waiter.wait([this, &can_continue]() {
+          return !can_continue || !_log.empty();
+        });
     }
+
+    while (drain())
+      ;
+    write(_stdout_sink, out_buffer);
   });
 }
 } // namespace Spektral::Log
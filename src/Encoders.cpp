@@ -0,0 +1,322 @@
+#include "Encoders.hpp"
+#include <atomic>
+#include <bit>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace Spektral::Log {
+
+namespace {
+/// What a string is scanned for.
+enum class Scan : char {
+  JSON,   ///< What needs escaping in a JSON string
+  LOGFMT, ///< What makes a logfmt value need quotes
+  TEXT    ///< Control characters, for OutputFormat::ESCAPED_TEXT
+};
+
+/// Whether c is one of the bytes S scans for.
+template <Scan S> constexpr bool special(unsigned char c) {
+  if constexpr (S == Scan::JSON)
+    return c < ' ' || c == '"' || c == '\\';
+  else if constexpr (S == Scan::LOGFMT)
+    return c <= ' ' || c == '"' || c == '\\' || c == '=';
+  else
+    return c < ' ' || c == 0x7f;
+}
+
+/// The widest scan find_special() uses, see set_scan_width().
+std::atomic<ScanWidth> scan_width{ScanWidth::AVX2};
+
+/// The highest byte S scans for below the printable characters: the control
+/// characters, and the space for logfmt.
+template <Scan S> constexpr char low_special = S == Scan::LOGFMT ? ' ' : ' ' - 1;
+
+// Each vector scan looks at the whole blocks of data from index ii on and
+// returns the index of the first special() byte, or the index where the
+// whole blocks end if there is none.
+
+#if defined(__x86_64__) || defined(__i386__)
+/// Whether the CPU (and the OS) support AVX2.
+bool has_avx2() noexcept {
+  static const bool available = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+  return available;
+}
+
+template <Scan S>
+__attribute__((target("avx2"))) std::size_t
+find_special_avx2(const char *data, std::size_t size, std::size_t ii) {
+  const __m256i low = _mm256_set1_epi8(low_special<S>);
+  for (; ii + 32 <= size; ii += 32) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + ii));
+    // block <= low as unsigned bytes, which AVX2 only compares as signed.
+    __m256i hits = _mm256_cmpeq_epi8(_mm256_max_epu8(block, low), low);
+    if constexpr (S == Scan::TEXT) {
+      hits = _mm256_or_si256(
+          hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(0x7f)));
+    } else {
+      hits = _mm256_or_si256(hits,
+                             _mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')));
+      hits = _mm256_or_si256(
+          hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\\')));
+      if constexpr (S == Scan::LOGFMT)
+        hits = _mm256_or_si256(
+            hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('=')));
+    }
+    if (auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hits)))
+      return ii + std::countr_zero(mask);
+  }
+  return ii;
+}
+#endif
+
+#if defined(__SSE2__)
+template <Scan S>
+std::size_t find_special_sse2(const char *data, std::size_t size,
+                              std::size_t ii) {
+  const __m128i low = _mm_set1_epi8(low_special<S>);
+  for (; ii + 16 <= size; ii += 16) {
+    __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + ii));
+    __m128i hits = _mm_cmpeq_epi8(_mm_max_epu8(block, low), low);
+    if constexpr (S == Scan::TEXT) {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(0x7f)));
+    } else {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8('"')));
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8('\\')));
+      if constexpr (S == Scan::LOGFMT)
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8('=')));
+    }
+    if (auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits)))
+      return ii + std::countr_zero(mask);
+  }
+  return ii;
+}
+#endif
+
+/**
+ * @brief The index of the first special() byte of str, str.size() if there is
+ * none. Scans 32-byte blocks with AVX2 when the CPU has it, then 16-byte ones
+ * with SSE2, then single bytes, up to scan_width.
+ */
+template <Scan S> std::size_t find_special(std::string_view str) {
+  const char *data = str.data();
+  std::size_t size = str.size(), ii = 0;
+  [[maybe_unused]] ScanWidth width = scan_width.load(std::memory_order_relaxed);
+#if defined(__x86_64__) || defined(__i386__)
+  if (width == ScanWidth::AVX2 && size >= 32 && has_avx2()) {
+    std::size_t blocks_end = size - size % 32;
+    ii = find_special_avx2<S>(data, size, ii);
+    if (ii < blocks_end)
+      return ii;
+  }
+#endif
+#if defined(__SSE2__)
+  if (width != ScanWidth::BYTES) {
+    std::size_t blocks_end = size - (size - ii) % 16;
+    ii = find_special_sse2<S>(data, size, ii);
+    if (ii < blocks_end)
+      return ii;
+  }
+#endif
+  for (; ii < size; ++ii)
+    if (special<S>(static_cast<unsigned char>(data[ii])))
+      return ii;
+  return size;
+}
+
+/// Appends the JSON escape of c, a special<Scan::JSON>() byte.
+void append_escape(std::string &out, char c) {
+  switch (c) {
+  case '"':
+    out += "\\\"";
+    break;
+  case '\\':
+    out += "\\\\";
+    break;
+  case '\n':
+    out += "\\n";
+    break;
+  case '\r':
+    out += "\\r";
+    break;
+  case '\t':
+    out += "\\t";
+    break;
+  case '\b':
+    out += "\\b";
+    break;
+  case '\f':
+    out += "\\f";
+    break;
+  default: {
+    constexpr char hex[] = "0123456789abcdef";
+    auto byte = static_cast<unsigned char>(c);
+    char buf[6] = {'\\', 'u', '0', '0', hex[byte >> 4], hex[byte & 0xf]};
+    out.append(buf, sizeof(buf));
+    break;
+  }
+  }
+}
+
+/// The name of level in the structured formats.
+std::string_view level_name(LogLevel level) {
+  switch (level) {
+    using enum LogLevel;
+  case INFO:
+    return "INFO";
+  case WARN:
+    return "WARN";
+  case DEBUG:
+    return "DEBUG";
+  case ERROR:
+    return "ERROR";
+  default:
+    return "UNKNOWN";
+  }
+}
+} // namespace
+
+void escape_json(std::string &out, std::string_view str) {
+  for (;;) {
+    std::size_t run = find_special<Scan::JSON>(str);
+    out.append(str.data(), run);
+    if (run == str.size())
+      return;
+    append_escape(out, str[run]);
+    str.remove_prefix(run + 1);
+  }
+}
+
+void append_logfmt(std::string &out, std::string_view str) {
+  if (!str.empty() && find_special<Scan::LOGFMT>(str) == str.size()) {
+    out += str;
+    return;
+  }
+  out += '"';
+  escape_json(out, str);
+  out += '"';
+}
+
+void escape_text(std::string &out, std::string_view str) {
+  constexpr char hex[] = "0123456789abcdef";
+  for (;;) {
+    std::size_t run = find_special<Scan::TEXT>(str);
+    out.append(str.data(), run);
+    if (run == str.size())
+      return;
+    switch (str[run]) {
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default: {
+      auto byte = static_cast<unsigned char>(str[run]);
+      char buf[4] = {'\\', 'x', hex[byte >> 4], hex[byte & 0xf]};
+      out.append(buf, sizeof(buf));
+      break;
+    }
+    }
+    str.remove_prefix(run + 1);
+  }
+}
+
+void set_scan_width(ScanWidth width) noexcept {
+  scan_width.store(width, std::memory_order_relaxed);
+}
+
+void IMessage::encode_to(Encoder &enc) { enc.field("msg", *this); }
+
+void Encoder::encode(std::string &out, LogEvent &event) {
+  if (_format == OutputFormat::TEXT) {
+    event.format_to(out, _ts);
+    return;
+  }
+  if (_format == OutputFormat::ESCAPED_TEXT) {
+    // Only the source and the message can hold control characters: format
+    // the record in place and rewrite it from the first one on, if any.
+    std::size_t start = out.size();
+    event.format_to(out, _ts);
+    std::string_view record(out.data() + start, out.size() - start - 1);
+    std::size_t first = find_special<Scan::TEXT>(record);
+    if (first == record.size())
+      return;
+    _scratch.assign(record.substr(first));
+    out.resize(start + first);
+    escape_text(out, _scratch);
+    out += '\n';
+    return;
+  }
+  // EPOCH_NS is a number, ISO8601 has no space for logfmt to quote.
+  bool quoted = _timestamp != TimestampFormat::EPOCH_NS &&
+                (_format == OutputFormat::JSON ||
+                 _timestamp == TimestampFormat::DEFAULT);
+  out += _format == OutputFormat::JSON ? "{\"ts\":" : "ts=";
+  if (quoted)
+    out += '"';
+  _ts.format_to(out, event.time);
+  if (quoted)
+    out += '"';
+
+  _out = &out;
+  field("level", level_name(event.level));
+  _scratch.clear();
+  event.source.format_to(_scratch);
+  field("source", std::string_view(_scratch));
+  if (IMessage *message = event.message.get()) {
+    message->encode_to(*this);
+  } else {
+    _scratch.clear();
+    event.message.format_to(_scratch);
+    field("msg", std::string_view(_scratch));
+  }
+  _out = nullptr;
+  out += _format == OutputFormat::JSON ? "}\n" : "\n";
+}
+
+void Encoder::field(std::string_view key, IMessage &message) {
+  _scratch.clear();
+  message.format_to(_scratch);
+  field(key, std::string_view(_scratch));
+}
+
+void Encoder::append_string(std::string &out, std::string_view str,
+                            OutputFormat format) {
+  switch (format) {
+  case OutputFormat::JSON:
+    out += '"';
+    escape_json(out, str);
+    out += '"';
+    break;
+  case OutputFormat::LOGFMT:
+    append_logfmt(out, str);
+    break;
+  default:
+    out += str;
+    break;
+  }
+}
+
+void Encoder::key(std::string_view key) {
+  if (_format == OutputFormat::JSON) {
+    *_out += ",\"";
+    *_out += key;
+    *_out += "\":";
+  } else {
+    *_out += ' ';
+    *_out += key;
+    *_out += '=';
+  }
+}
+
+} // namespace Spektral::Log
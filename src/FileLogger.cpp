@@ -1,48 +1,247 @@
 #include "FileLogger.hpp"
+#include <algorithm>
 #include <cmath>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
 #include <future>
 #include <iostream>
-#define LOG_MAX_SZ 100000000
+#include <optional>
+#include <stdexcept>
 
 namespace Spektral::Log {
 
-FileLogger::FileLogger(const std::string &file_path)
-    : _sink(std::make_shared<std::ofstream>(file_path)), _can_continue(true) {
-  if (!_sink->is_open())
+namespace {
+/// Whether opts enable rotation.
+bool rotates(const FileOptions &opts) {
+  return opts.rotate_bytes || opts.rotate_interval.count() ||
+         opts.rotate_on_request;
+}
+
+/// Throws std::invalid_argument if opts cannot be honoured. Called before the
+/// file is opened, so that rejected options leave it untouched.
+const FileOptions &validate(const FileOptions &opts) {
+  if (rotates(opts) && opts.backend == FileBackend::MMAP)
+    throw std::invalid_argument(
+        "FileLogger: rotation is not supported with FileBackend::MMAP");
+  if (opts.compression != Compression::NONE &&
+      !Compressor::available(opts.compression))
+    throw std::invalid_argument(
+        "FileLogger: the library was built without this compression codec");
+  return opts;
+}
+
+/// Opens file_path and wraps it in the sink selected by opts. The file is
+/// truncated, or written from its end on if append is set.
+std::unique_ptr<ISink> open_sink(const std::string &file_path,
+                                 const FileOptions &opts,
+                                 bool append = false) {
+  if (opts.backend == FileBackend::MMAP)
+    return std::make_unique<MmapSink>(file_path, opts.segment_bytes,
+                                      opts.msync);
+  int fd = ::open(file_path.c_str(),
+                  O_WRONLY | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC),
+                  0644);
+  if (fd < 0)
     throw std::runtime_error(std::format("Failed to open file: {}", file_path));
+  // Not O_APPEND: IoUringSink's writes carry their own offsets.
+  if (append)
+    ::lseek(fd, 0, SEEK_END);
+  std::unique_ptr<ISink> sink;
+  if (opts.backend == FileBackend::IO_URING)
+    // Leave room for the event that pushes a batch past batch_bytes.
+    sink = IoUringSink::Make(fd, 2 * opts.batch_bytes, opts.uring_buffers);
+  if (!sink)
+    sink = std::make_unique<FdSink>(fd);
+  return sink;
+}
+} // namespace
+
+FileLogger::FileLogger(const std::string &file_path, WaitStrategy wait)
+    : FileLogger(file_path, FileOptions{.wait = wait}) {}
+
+FileLogger::FileLogger(const std::string &file_path, const FileOptions &opts)
+    : _opts(validate(opts)), _clock(opts.clock),
+      _sink(open_sink(file_path, opts, rotates(opts))),
+      _log_queue(opts.overflow, opts.overflow_level, opts.lane_events),
+      _can_continue(true),
+      _waiter(opts.wait) {
+  if (rotates(opts)) {
+    std::error_code ec;
+    _initial_bytes = std::filesystem::file_size(file_path, ec);
+    if (ec)
+      _initial_bytes = 0;
+    _rotator = std::make_unique<Rotator>(
+        file_path,
+        [opts](const std::string &path) { return open_sink(path, opts); },
+        opts.retain, opts.compress && opts.compression == Compression::NONE,
+        _waiter);
+  }
   _ref = start_backend(_can_continue);
 }
 
 FileLogger::~FileLogger() {
   _can_continue = false;
+  _waiter.wake();
   _ref.get();
-  _log_queue.clear();
-  _sink->close();
 }
 
 void FileLogger::insert(LogEvent &&event) {
-  _log_queue.emplace_back(std::make_shared<LogEvent>(std::move(event)));
+  if (_log_queue.push(std::move(event), _waiter))
+    _waiter.notify();
+}
+
+void FileLogger::rotate() {
+  if (!_rotator)
+    throw std::logic_error("FileLogger: rotation is not enabled");
+  _rotate_requested.store(true, std::memory_order_relaxed);
+  _waiter.wake();
+}
+
+void FileLogger::emplace(LogLevel level, Payload<ISource> source,
+                         Payload<IMessage> message) {
+  insert(LogEvent(level, _clock.now(), std::move(source), std::move(message)));
 }
 
 std::future<void> FileLogger::start_backend(std::atomic<bool> &can_continue) {
   return std::async(std::launch::async, [this, &can_continue]() -> void {
-    while (can_continue) {
-      if (!_log_queue.empty()) {
-        auto &front = _log_queue.front();
-        if (front) {
-          (*_sink) << front->operator std::string() << std::flush;
-        }
-        _log_queue.pop_front();
+    using steady = std::chrono::steady_clock;
+    std::vector<LogEvent> batch;
+    std::string buffer;
+    buffer.reserve(_opts.batch_bytes);
+    Encoder encoder(_opts.format, _opts.timestamp, _opts.timestamp_precision);
+    auto last_write = steady::now();
+    // What the live file holds and how old it is, for rotation: an empty file
+    // is not rotated by age, and ages from its first write.
+    std::size_t file_bytes = _initial_bytes;
+    bool file_empty = _initial_bytes == 0;
+    auto file_opened = last_write;
+    // Compresses and writes the batches while the next one is formatted.
+    std::optional<Compressor> compressor;
+    if (_opts.compression != Compression::NONE)
+      compressor.emplace(_opts.compression, _opts.compression_level,
+                         _opts.compression_frame_bytes);
+    // The part of Compressor::written() already added to file_bytes.
+    std::uint64_t counted = 0;
+
+    auto write_buffer = [this, &buffer, &last_write, &file_bytes, &file_empty,
+                         &file_opened, &compressor, &counted]() {
+      if (buffer.empty())
+        return;
+      if (file_empty) {
+        file_empty = false;
+        file_opened = steady::now();
       }
-    }
+      if (compressor) {
+        // Counts the blocks written so far, not the ones just submitted.
+        compressor->submit(buffer, *_sink);
+        std::uint64_t written = compressor->written();
+        file_bytes += written - counted;
+        counted = written;
+      } else {
+        _sink->write(buffer);
+        file_bytes += buffer.size();
+        buffer.clear();
+      }
+      last_write = steady::now();
+    };
+
+    // Whether the live file is due to be rotated.
+    auto rotation_due = [this, &file_bytes, &file_empty, &file_opened]() {
+      return _rotator &&
+             (_rotate_requested.load(std::memory_order_relaxed) ||
+              (_opts.rotate_bytes && file_bytes >= _opts.rotate_bytes) ||
+              (_opts.rotate_interval.count() && !file_empty &&
+               steady::now() - file_opened >= _opts.rotate_interval));
+    };
+
+    // Rotates between batches if it is due and the next file is ready; if it
+    // is not, the batch goes to the live file and the next one tries again.
+    auto maybe_rotate = [this, &file_bytes, &file_empty, &write_buffer,
+                         &compressor, &counted, &rotation_due]() {
+      if (!rotation_due() || !_rotator->ready())
+        return;
+      write_buffer();
+      // The frame in flight belongs to the live file, and ends there.
+      if (compressor)
+        compressor->end_frame();
+      if (_rotator->try_rotate(_sink)) {
+        _rotate_requested.store(false, std::memory_order_relaxed);
+        file_bytes = 0;
+        file_empty = true;
+        counted = compressor ? compressor->written() : 0;
+      }
+    };
 
-    while (!_log_queue.empty()) {
-      auto &front = _log_queue.front();
-      if (front) {
-        (*_sink) << front->operator std::string() << std::flush;
+    // Drains one round of every thread's lane, formats it in time order and
+    // writes it out if the flush policy says so. Returns whether anything was
+    // drained.
+    auto drain = [this, &batch, &buffer, &encoder, &last_write,
+                  &write_buffer]() -> bool {
+      _log_queue.drain(
+          [&batch](LogEvent &&event) {
+            batch.push_back(std::move(event));
+          },
+          _opts.batch_events);
+      if (auto report = _log_queue.report_dropped())
+        batch.push_back(std::move(*report));
+      std::stable_sort(batch.begin(), batch.end(),
+                       [](const auto &lhs, const auto &rhs) {
+                         return lhs.time < rhs.time;
+                       });
+      bool saw_error = false;
+      for (auto &event : batch) {
+        encoder.encode(buffer, event);
+        saw_error |= event.level == LogLevel::ERROR;
+        if (buffer.size() >= _opts.batch_bytes)
+          write_buffer();
+      }
+      switch (_opts.flush) {
+      case FlushPolicy::EVERY_BATCH:
+        write_buffer();
+        break;
+      case FlushPolicy::INTERVAL:
+        if (steady::now() - last_write >= _opts.flush_interval)
+          write_buffer();
+        break;
+      case FlushPolicy::ON_ERROR:
+        if (saw_error)
+          write_buffer();
+        break;
+      }
+      bool drained = !batch.empty();
+      batch.clear();
+      return drained;
+    };
+
+    while (can_continue) {
+      maybe_rotate();
+      if (drain()) {
+        _waiter.reset();
+      } else {
+        write_buffer();
+        // An idle backend still rotates on time: wake up when the interval
+        // runs out. Once it has, the helper wakes us when the next file is
+        // ready.
+        auto deadline = steady::time_point::max();
+        if (_rotator && _opts.rotate_interval.count() && !file_empty &&
+            steady::now() - file_opened < _opts.rotate_interval)
+          deadline = file_opened + _opts.rotate_interval;
+        _waiter.wait(
+            [this, &can_continue, &rotation_due]() {
+              return !can_continue || !_log_queue.empty() ||
+                     (rotation_due() && _rotator->ready());
+            },
+            deadline);
       }
-      _log_queue.pop_front();
     }
+
+    do
+      maybe_rotate();
+    while (drain());
+    write_buffer();
+    compressor.reset();
+    _sink->sync();
   });
 }
 } // namespace Spektral::Log
@@ -0,0 +1,63 @@
+#include "FrontEnd.hpp"
+#include <mutex>
+#include <stdexcept>
+
+namespace Spektral::Log {
+
+namespace {
+/// The process-wide logger, read by get_log() without locking.
+std::atomic<FrontEnd *> instance{nullptr};
+/// Serializes the creation of instance.
+std::mutex instance_mtx;
+
+/// Owns instance, so that it writes what is pending when the program exits.
+/// Only called once the FrontEnd exists: the ConsoleLogger it logs to is a
+/// function-local static too, which must be constructed first to be destroyed
+/// last.
+std::unique_ptr<FrontEnd> &owner() {
+  static std::unique_ptr<FrontEnd> front_end;
+  return front_end;
+}
+} // namespace
+
+FrontEnd::FrontEnd(const LogOptions &opts)
+    : _min_level(opts.min_level), _router(opts.clock) {
+  if (opts.console)
+    // Filtering happens here, the console logger takes everything.
+    _router.add(ConsoleLogger::get_inst(LogLevel::INFO, opts.console_wait,
+                                        ClockSource::SYSTEM,
+                                        opts.console_overflow,
+                                        opts.console_format),
+                opts.console_level);
+  if (!opts.file_path.empty()) {
+    _file = std::make_unique<FileLogger>(opts.file_path, opts.file);
+    _router.add(*_file, opts.file_level);
+  }
+}
+
+FrontEnd::~FrontEnd() { instance = nullptr; }
+
+FrontEnd &make_log(const LogOptions &opts) {
+  std::lock_guard lock(instance_mtx);
+  if (instance.load(std::memory_order_relaxed))
+    throw std::logic_error("make_log() called after the logger was created");
+  std::unique_ptr<FrontEnd> front_end(new FrontEnd(opts));
+  instance.store(front_end.get(), std::memory_order_release);
+  owner() = std::move(front_end);
+  return *owner();
+}
+
+FrontEnd &get_log() {
+  if (FrontEnd *front_end = instance.load(std::memory_order_acquire))
+      [[likely]]
+    return *front_end;
+  std::lock_guard lock(instance_mtx);
+  if (!instance.load(std::memory_order_relaxed)) {
+    std::unique_ptr<FrontEnd> front_end(new FrontEnd(LogOptions{}));
+    instance.store(front_end.get(), std::memory_order_release);
+    owner() = std::move(front_end);
+  }
+  return *instance.load(std::memory_order_relaxed);
+}
+
+} // namespace Spektral::Log
@@ -1,54 +1,61 @@
 #include "LogEvent.hpp"
 #include "LogCustomErrors.hpp"
-#include <format>
-#include <iostream>
+#include "TimestampFormatter.hpp"
+#include <string_view>
 
-Spektral::Log::LogEvent::LogEvent(LogLevel level,
-                                  std::unique_ptr<ISource> source,
-                                  std::unique_ptr<IMessage> message) {
-  if (message == nullptr)
-    throw message_nullptr_exception();
-  if (source == nullptr)
-    throw source_nullptr_exception();
-  time = std_clock::now();
-  this->level = std::move(level);
-  this->source = std::move(source);
-  this->message = std::move(message);
+Spektral::Log::LogEvent::LogEvent(LogLevel level, Payload<ISource> source,
+                                  Payload<IMessage> message)
+    : LogEvent(level, std_clock::now(), std::move(source), std::move(message)) {
 }
 
-Spektral::Log::LogEvent::LogEvent(LogEvent &&l) {
-  if (l.message == nullptr)
+Spektral::Log::LogEvent::LogEvent(LogLevel level, std_time_t time,
+                                  Payload<ISource> source,
+                                  Payload<IMessage> message)
+    : level(level), time(time), source(std::move(source)),
+      message(std::move(message)) {
+  if (this->message == nullptr)
     throw message_nullptr_exception();
-  if (l.source == nullptr)
+  if (this->source == nullptr)
     throw source_nullptr_exception();
-
-  message = std::move(l.message);
-  source = std::move(l.source);
-  time = std::move(l.time);
-  level = std::move(l.level);
 }
 
 Spektral::Log::LogEvent::operator std::string() {
+  static thread_local TimestampFormatter ts;
+  return to_string(ts);
+}
+
+std::string Spektral::Log::LogEvent::to_string(TimestampFormatter &ts) {
+  std::string out;
+  format_to(out, ts);
+  return out;
+}
+
+void Spektral::Log::LogEvent::format_to(std::string &out,
+                                        TimestampFormatter &ts) {
+  std::string_view from = " from ";
   switch (level) {
     using enum LogLevel;
   case INFO:
-    return std::format("INFO: {} {} from {}\n", time,
-                       message->operator std::string(),
-                       source->operator std::string());
+    out += "INFO: ";
+    break;
   case WARN:
-    return std::format("WARN: {} {} from {}\n", time,
-                       message->operator std::string(),
-                       source->operator std::string());
+    out += "WARN: ";
+    break;
   case DEBUG:
-    return std::format("DEBUG: {} {} from {}\n", time,
-                       message->operator std::string(),
-                       source->operator std::string());
+    out += "DEBUG: ";
+    break;
   case ERROR:
-    return std::format("ERROR: {} {} from {}\n", time,
-                       message->operator std::string(),
-                       source->operator std::string());
+    out += "ERROR: ";
+    break;
+  default:
+    out += "UNKOWN_LEVEL: ";
+    from = " ";
+    break;
   }
-  return std::format("UNKOWN_LEVEL: {} {} {}\n", time,
-                     message->operator std::string(),
-                     source->operator std::string());
+  ts.format_to(out, time);
+  out += ' ';
+  message.format_to(out);
+  out += from;
+  source.format_to(out);
+  out += '\n';
 }
@@ -0,0 +1,64 @@
+#include "Overflow.hpp"
+#include "LogCustomErrors.hpp"
+#include <chrono>
+#include <format>
+#include <thread>
+
+namespace Spektral::Log {
+
+OverflowQueue::OverflowQueue(OverflowPolicy policy, LogLevel level,
+                             std::size_t lane_capacity)
+    : _policy(policy), _level(level) {
+  if (policy == OverflowPolicy::DROP_OLDEST)
+    _lanes.emplace<EvictingLanes>(lane_capacity);
+  else
+    _lanes.emplace<Lanes>(lane_capacity);
+}
+
+bool OverflowQueue::overflow(LogEvent &&event, Waiter &waiter) {
+  using enum OverflowPolicy;
+  switch (_policy) {
+  case THROW:
+    throw full_queue_exception(event.level);
+  case DROP_BELOW_LEVEL:
+    if (event.level >= _level)
+      break;
+    [[fallthrough]];
+  case DROP_NEWEST:
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  case DROP_OLDEST: {
+    auto &lanes = std::get<EvictingLanes>(_lanes);
+    while (!lanes.try_push(std::move(event)))
+      if (lanes.evict())
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  case BLOCK:
+    break;
+  }
+
+  // Wait for the backend: yield while it is draining, then back off to short
+  // sleeps so that a producer stuck behind a stalled disk does not burn a core.
+  auto &lanes = std::get<Lanes>(_lanes);
+  for (unsigned tries = 0; !lanes.try_push(std::move(event)); ++tries) {
+    waiter.notify();
+    if (tries < 64)
+      std::this_thread::yield();
+    else
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  return true;
+}
+
+std::optional<LogEvent> OverflowQueue::report_dropped() {
+  std::uint64_t dropped = _dropped.load(std::memory_order_relaxed);
+  if (dropped == _reported || !empty())
+    return std::nullopt;
+  std::uint64_t count = dropped - _reported;
+  _reported = dropped;
+  return LogEvent(LogLevel::WARN, std_clock::now(), "Spektral::Log",
+                  std::format("dropped {} events: queue full", count));
+}
+
+} // namespace Spektral::Log
@@ -0,0 +1,183 @@
+#include "Rotator.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define SPEKTRAL_LOG_HAS_ZLIB 1
+#else
+#define SPEKTRAL_LOG_HAS_ZLIB 0
+#endif
+
+namespace Spektral::Log {
+
+namespace {
+/// Reports an error of the helper thread, which has no caller to throw to.
+void report(std::string_view what, const std::string &path) {
+  std::cerr << std::format("Spektral::Log: {} {}: {}\n", what, path,
+                           std::strerror(errno));
+}
+
+/// The indices N of the existing "<path>.N" and "<path>.N.gz" files, sorted.
+std::deque<std::uint64_t> rotated_files(const std::string &path) {
+  namespace fs = std::filesystem;
+  fs::path live(path);
+  fs::path dir = live.has_parent_path() ? live.parent_path() : fs::path(".");
+  std::string prefix = live.filename().string() + '.';
+  std::vector<std::uint64_t> found;
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(dir, ec)) {
+    std::string name = entry.path().filename().string();
+    if (!name.starts_with(prefix))
+      continue;
+    std::string_view rest = std::string_view(name).substr(prefix.size());
+    if (rest.ends_with(".gz"))
+      rest.remove_suffix(3);
+    std::uint64_t index;
+    auto [end, err] =
+        std::from_chars(rest.data(), rest.data() + rest.size(), index);
+    if (err == std::errc() && end == rest.data() + rest.size())
+      found.push_back(index);
+  }
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+  return {found.begin(), found.end()};
+}
+
+#if SPEKTRAL_LOG_HAS_ZLIB
+/// Compresses src into dst and deletes src. Level 1: logs compress well even
+/// at the fastest level, which keeps the helper's CPU burst short.
+void gzip(const std::string &src, const std::string &dst) {
+  int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+  if (in < 0)
+    return report("failed to open", src);
+  ::posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+  gzFile out = ::gzopen(dst.c_str(), "wb1");
+  if (!out) {
+    ::close(in);
+    return report("failed to create", dst);
+  }
+  std::vector<char> buf(1 << 20);
+  bool ok = true;
+  for (;;) {
+    ssize_t n = ::read(in, buf.data(), buf.size());
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      ok = n == 0;
+      break;
+    }
+    if (::gzwrite(out, buf.data(), static_cast<unsigned>(n)) != n) {
+      ok = false;
+      break;
+    }
+  }
+  ok &= ::gzclose(out) == Z_OK;
+  ::close(in);
+  if (!ok) {
+    report("failed to compress", src);
+    std::remove(dst.c_str());
+    return;
+  }
+  std::remove(src.c_str());
+}
+#endif
+} // namespace
+
+Rotator::Rotator(std::string path, SinkFactory open_sink, unsigned retain,
+                 bool compress, Waiter &waiter)
+    : _path(std::move(path)), _next_path(_path + ".next"),
+      _open_sink(std::move(open_sink)), _retain(retain),
+      _compress(compress && SPEKTRAL_LOG_HAS_ZLIB), _waiter(waiter),
+      _kept(rotated_files(_path)), _index(_kept.empty() ? 0 : _kept.back()),
+      _helper([this](std::stop_token stop) { run(stop); }) {}
+
+Rotator::~Rotator() {
+  _helper.request_stop();
+  _signal.fetch_add(1, std::memory_order_release);
+  _signal.notify_one();
+  _helper.join();
+  if (ISink *next = _next.exchange(nullptr, std::memory_order_acquire)) {
+    delete next;
+    std::remove(_next_path.c_str());
+  }
+}
+
+void Rotator::run(std::stop_token stop) {
+  for (;;) {
+    std::uint32_t seen = _signal.load(std::memory_order_acquire);
+    if (ISink *retired = _retired.exchange(nullptr, std::memory_order_acquire)) {
+      retire(std::unique_ptr<ISink>(retired));
+      std::uint64_t index = _index;
+      // The next file first: compressing can take a while.
+      if (!stop.stop_requested())
+        prepare();
+      archive(index);
+      continue;
+    }
+    if (stop.stop_requested())
+      return;
+    if (!ready() && !_next_failed) {
+      prepare();
+      continue;
+    }
+    if (_next_failed) {
+      // E.g. the disk is full: the backend keeps writing to the live file,
+      // try again in a second.
+      for (int ii = 0; ii < 100 && !stop.stop_requested(); ++ii)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      _next_failed = false;
+      continue;
+    }
+    _signal.wait(seen, std::memory_order_acquire);
+  }
+}
+
+void Rotator::prepare() {
+  try {
+    std::unique_ptr<ISink> next = _open_sink(_next_path);
+    _next.store(next.release(), std::memory_order_release);
+    _waiter.wake();
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Spektral::Log: {}\n", e.what());
+    _next_failed = true;
+  }
+}
+
+void Rotator::retire(std::unique_ptr<ISink> retired) {
+  retired->sync();
+  retired.reset();
+  std::string rotated = std::format("{}.{}", _path, ++_index);
+  if (::rename(_path.c_str(), rotated.c_str()) != 0)
+    report("failed to rename", _path);
+  if (::rename(_next_path.c_str(), _path.c_str()) != 0)
+    report("failed to rename", _next_path);
+}
+
+void Rotator::archive(std::uint64_t index) {
+  std::string rotated = std::format("{}.{}", _path, index);
+#if SPEKTRAL_LOG_HAS_ZLIB
+  if (_compress)
+    gzip(rotated, rotated + ".gz");
+#endif
+  _kept.push_back(index);
+  while (_retain && _kept.size() > _retain) {
+    std::string old = std::format("{}.{}", _path, _kept.front());
+    std::remove(old.c_str());
+    std::remove((old + ".gz").c_str());
+    _kept.pop_front();
+  }
+}
+
+} // namespace Spektral::Log
@@ -0,0 +1,110 @@
+#include "Router.hpp"
+#include "Encoders.hpp"
+#include "LogCustomErrors.hpp"
+#include "SlabAllocator.hpp"
+#include <memory>
+
+namespace Spektral::Log {
+
+namespace {
+/// The source and message shared by the copies of a routed event.
+struct SharedPayloads {
+  Payload<ISource> source;
+  Payload<IMessage> message;
+};
+using SharedPtr = std::shared_ptr<const SharedPayloads>;
+
+/// Allocates the shared block and its reference counts with
+/// LOG_PAYLOAD_ALLOCATOR.
+template <typename T> struct PayloadAllocator {
+  using value_type = T;
+
+  PayloadAllocator() = default;
+  template <typename U> PayloadAllocator(const PayloadAllocator<U> &) noexcept {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(LOG_PAYLOAD_ALLOCATOR::allocate(n * sizeof(T)));
+  }
+  void deallocate(T *ptr, std::size_t n) noexcept {
+    LOG_PAYLOAD_ALLOCATOR::deallocate(ptr, n * sizeof(T));
+  }
+  template <typename U>
+  bool operator==(const PayloadAllocator<U> &) const noexcept {
+    return true;
+  }
+};
+
+/// The source of one copy of a routed event.
+class SharedSource : public ISource {
+  SharedPtr shared;
+
+public:
+  explicit SharedSource(SharedPtr ptr) noexcept : shared(std::move(ptr)) {}
+  operator std::string() override { return std::string(shared->source); }
+  void format_to(std::string &out) override { shared->source.format_to(out); }
+};
+
+/// The message of one copy of a routed event.
+class SharedMessage : public IMessage {
+  SharedPtr shared;
+
+public:
+  explicit SharedMessage(SharedPtr ptr) noexcept : shared(std::move(ptr)) {}
+  operator std::string() override { return std::string(shared->message); }
+  void format_to(std::string &out) override { shared->message.format_to(out); }
+  /// Keeps the fields of a structured message.
+  void encode_to(Encoder &enc) override {
+    if (IMessage *message = shared->message.get())
+      message->encode_to(enc);
+    else
+      enc.field("msg", *this);
+  }
+};
+} // namespace
+
+Router::Router(ClockSource clock) : _clock(clock) {}
+
+void Router::send(Route &route, LogEvent &&event) {
+  try {
+    route.insert(route.logger, std::move(event));
+  } catch (const full_queue_exception &) {
+    route.dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Router::log(LogLevel level, Payload<ISource> source,
+                 Payload<IMessage> message) {
+  Route *first = nullptr;
+  std::size_t matches = 0;
+  for (Route &route : _routes) {
+    if (level < route.min_level)
+      continue;
+    if (!first)
+      first = &route;
+    ++matches;
+  }
+  if (!matches)
+    return;
+  std_time_t time = _clock.now();
+  if (matches == 1) {
+    send(*first, LogEvent(level, time, std::move(source), std::move(message)));
+    return;
+  }
+
+  // Checked once here rather than by every copy.
+  if (message == nullptr)
+    throw message_nullptr_exception();
+  if (source == nullptr)
+    throw source_nullptr_exception();
+  SharedPtr shared = std::allocate_shared<const SharedPayloads>(
+      PayloadAllocator<SharedPayloads>(),
+      SharedPayloads{std::move(source), std::move(message)});
+  for (Route &route : _routes) {
+    if (level < route.min_level)
+      continue;
+    send(route, LogEvent(level, time, SharedSource(shared),
+                         SharedMessage(shared)));
+  }
+}
+
+} // namespace Spektral::Log
@@ -0,0 +1,48 @@
+#include "ShardedFileLogger.hpp"
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+namespace Spektral::Log {
+
+ShardedFileLogger::ShardedFileLogger(const std::string &file_path,
+                                     std::size_t shards, ShardBy by,
+                                     const FileOptions &opts)
+    : _by(by), _clock(opts.clock) {
+  if (shards == 0)
+    throw std::invalid_argument("ShardedFileLogger needs at least one shard");
+  _shards.reserve(shards);
+  for (std::size_t ii = 0; ii < shards; ++ii)
+    _shards.push_back(
+        std::make_unique<FileLogger>(shard_path(file_path, ii), opts));
+}
+
+std::uint64_t ShardedFileLogger::dropped() const noexcept {
+  std::uint64_t dropped = 0;
+  for (const auto &shard : _shards)
+    dropped += shard->dropped();
+  return dropped;
+}
+
+std::string ShardedFileLogger::shard_path(const std::string &file_path,
+                                          std::size_t shard) {
+  return file_path + '.' + std::to_string(shard);
+}
+
+std::size_t ShardedFileLogger::shard_of(const LogEvent &event) const {
+  if (_by == ShardBy::THREAD) {
+    // Numbered in the order threads first log, so that consecutive threads
+    // land on different shards whatever their ids hash to.
+    static std::atomic<std::size_t> threads{0};
+    thread_local std::size_t thread_index =
+        threads.fetch_add(1, std::memory_order_relaxed);
+    return thread_index % _shards.size();
+  }
+  thread_local std::string source;
+  source.clear();
+  event.source.format_to(source);
+  return std::hash<std::string_view>{}(source) % _shards.size();
+}
+
+} // namespace Spektral::Log
@@ -0,0 +1,402 @@
+#include "Sinks.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <format>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define SPEKTRAL_LOG_HAS_IO_URING 1
+#else
+#define SPEKTRAL_LOG_HAS_IO_URING 0
+#endif
+
+namespace Spektral::Log {
+
+FdSink::FdSink(int fd, bool owned) : _fd(fd), _owned(owned) {}
+
+FdSink::~FdSink() {
+  if (_owned)
+    ::close(_fd);
+}
+
+void FdSink::write(std::string_view data) {
+  while (!data.empty()) {
+    ssize_t n = ::write(_fd, data.data(), data.size());
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        pollfd pfd{.fd = _fd, .events = POLLOUT, .revents = 0};
+        ::poll(&pfd, 1, -1);
+        continue;
+      }
+      return; // Nothing sensible to do from the backend; drop the batch.
+    }
+    data.remove_prefix(static_cast<std::size_t>(n));
+  }
+}
+
+MmapSink::MmapSink(const std::string &file_path, std::size_t segment_sz,
+                   MsyncPolicy policy)
+    : _path(file_path), _segment_sz([segment_sz]() {
+        auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        return std::max(page, (segment_sz + page - 1) / page * page);
+      }()),
+      _policy(policy) {
+  if (!open_segment())
+    throw std::runtime_error(std::format("Failed to open file: {}", _path));
+}
+
+MmapSink::~MmapSink() { close_segment(); }
+
+void MmapSink::write(std::string_view data) {
+  if (!_map)
+    return; // A roll over failed, there is nowhere to write to.
+  std::size_t start = _pos;
+  while (!data.empty()) {
+    // Rolls over rather than splitting what would fit in a segment of its
+    // own, so that every segment holds whole records.
+    if (data.size() > _segment_sz - _pos && _pos != 0) {
+      close_segment();
+      ++_segment;
+      if (!open_segment())
+        return;
+      start = 0;
+    }
+    std::size_t n = std::min(data.size(), _segment_sz - _pos);
+    // A batch larger than a segment is split after its last record that
+    // fits; only a single record larger than a segment is cut.
+    if (n < data.size())
+      if (std::size_t eol = data.substr(0, n).rfind('\n');
+          eol != std::string_view::npos)
+        n = eol + 1;
+    std::memcpy(_map + _pos, data.data(), n);
+    _pos += n;
+    data.remove_prefix(n);
+  }
+  if (_policy == MsyncPolicy::ASYNC || _policy == MsyncPolicy::SYNC) {
+    // msync wants a page aligned start address.
+    auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t from = start / page * page;
+    ::msync(_map + from, _pos - from,
+            _policy == MsyncPolicy::SYNC ? MS_SYNC : MS_ASYNC);
+  }
+}
+
+bool MmapSink::open_segment() {
+  std::string name =
+      _segment == 0 ? _path : std::format("{}.{}", _path, _segment);
+  _fd = ::open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (_fd < 0)
+    return false;
+  // posix_fallocate reserves the blocks up front where the file system can;
+  // ftruncate at least gives the mapping something to stand on where it
+  // cannot.
+  auto sz = static_cast<off_t>(_segment_sz);
+  if (::posix_fallocate(_fd, 0, sz) != 0 && ::ftruncate(_fd, sz) != 0) {
+    ::close(_fd);
+    _fd = -1;
+    return false;
+  }
+  void *map = ::mmap(nullptr, _segment_sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     _fd, 0);
+  if (map == MAP_FAILED) {
+    ::close(_fd);
+    _fd = -1;
+    return false;
+  }
+  _map = static_cast<char *>(map);
+  _pos = 0;
+  return true;
+}
+
+void MmapSink::close_segment() {
+  if (!_map)
+    return;
+  if (_policy != MsyncPolicy::NONE)
+    ::msync(_map, _pos, MS_SYNC);
+  ::munmap(_map, _segment_sz);
+  _map = nullptr;
+  // On failure the segment keeps its zero-filled tail, exactly as after a
+  // crash.
+  (void)::ftruncate(_fd, static_cast<off_t>(_pos));
+  ::close(_fd);
+  _fd = -1;
+}
+
+#if SPEKTRAL_LOG_HAS_IO_URING
+
+struct IoUringSink::Ring {
+  int fd = -1;
+  void *sq_ptr = MAP_FAILED;
+  std::size_t sq_sz = 0;
+  void *cq_ptr = MAP_FAILED;
+  std::size_t cq_sz = 0;
+  io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+  std::size_t sqes_sz = 0;
+  void *bufs = MAP_FAILED;
+  std::size_t bufs_sz = 0;
+
+  unsigned *sq_head = nullptr;
+  unsigned *sq_tail = nullptr;
+  unsigned *sq_mask = nullptr;
+  unsigned *sq_array = nullptr;
+  unsigned *cq_head = nullptr;
+  unsigned *cq_tail = nullptr;
+  unsigned *cq_mask = nullptr;
+  io_uring_cqe *cqes = nullptr;
+
+  /// Whether the staging buffers / the fd are registered with the ring.
+  bool fixed_bufs = false;
+  bool fixed_file = false;
+
+  ~Ring() {
+    if (bufs != MAP_FAILED)
+      ::munmap(bufs, bufs_sz);
+    if (sqes != MAP_FAILED)
+      ::munmap(sqes, sqes_sz);
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+      ::munmap(cq_ptr, cq_sz);
+    if (sq_ptr != MAP_FAILED)
+      ::munmap(sq_ptr, sq_sz);
+    if (fd >= 0)
+      ::close(fd);
+  }
+
+  int enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                      min_complete, flags, nullptr, 0));
+  }
+};
+
+std::unique_ptr<IoUringSink> IoUringSink::Make(int fd, std::size_t buffer_sz,
+                                               unsigned buffers) {
+  buffers = std::max(buffers, 1u);
+  io_uring_params params{};
+  auto ring = std::make_unique<Ring>();
+  ring->fd = static_cast<int>(
+      ::syscall(__NR_io_uring_setup, buffers * 2, &params));
+  if (ring->fd < 0)
+    return nullptr;
+
+  ring->sq_sz = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_sz = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap)
+    ring->sq_sz = ring->cq_sz = std::max(ring->sq_sz, ring->cq_sz);
+  ring->sq_ptr = ::mmap(nullptr, ring->sq_sz, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ptr == MAP_FAILED)
+    return nullptr;
+  ring->cq_ptr = single_mmap
+                     ? ring->sq_ptr
+                     : ::mmap(nullptr, ring->cq_sz, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ring->fd,
+                              IORING_OFF_CQ_RING);
+  if (ring->cq_ptr == MAP_FAILED)
+    return nullptr;
+  ring->sqes_sz = params.sq_entries * sizeof(io_uring_sqe);
+  ring->sqes = static_cast<io_uring_sqe *>(
+      ::mmap(nullptr, ring->sqes_sz, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+  if (ring->sqes == MAP_FAILED)
+    return nullptr;
+
+  auto *sq = static_cast<char *>(ring->sq_ptr);
+  auto *cq = static_cast<char *>(ring->cq_ptr);
+  ring->sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  ring->sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  ring->sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  ring->sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  ring->cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  ring->cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  ring->cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  ring->cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+  ring->bufs_sz = buffer_sz * buffers;
+  ring->bufs = ::mmap(nullptr, ring->bufs_sz, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ring->bufs == MAP_FAILED)
+    return nullptr;
+
+  std::vector<Buffer> bufs(buffers);
+  std::vector<iovec> iovs(buffers);
+  for (unsigned ii = 0; ii < buffers; ++ii) {
+    bufs[ii].data = static_cast<char *>(ring->bufs) + ii * buffer_sz;
+    iovs[ii] = {bufs[ii].data, buffer_sz};
+  }
+  // Registration can fail on kernels that charge it to RLIMIT_MEMLOCK; plain
+  // IORING_OP_WRITE on the unregistered buffers still works there.
+  ring->fixed_bufs = ::syscall(__NR_io_uring_register, ring->fd,
+                               IORING_REGISTER_BUFFERS, iovs.data(),
+                               buffers) == 0;
+  ring->fixed_file = ::syscall(__NR_io_uring_register, ring->fd,
+                               IORING_REGISTER_FILES, &fd, 1) == 0;
+
+  return std::unique_ptr<IoUringSink>(
+      new IoUringSink(fd, std::move(ring), buffer_sz, std::move(bufs)));
+}
+
+IoUringSink::IoUringSink(int fd, std::unique_ptr<Ring> ring,
+                         std::size_t buffer_sz, std::vector<Buffer> buffers)
+    : _fd(fd), _ring(std::move(ring)), _buffer_sz(buffer_sz),
+      _buffers(std::move(buffers)) {
+  off_t off = ::lseek(_fd, 0, SEEK_CUR);
+  _offset = off < 0 ? 0 : static_cast<std::uint64_t>(off);
+}
+
+IoUringSink::~IoUringSink() {
+  sync();
+  _ring.reset();
+  ::close(_fd);
+}
+
+void IoUringSink::write(std::string_view data) {
+  while (!data.empty()) {
+    auto free_buf = std::find_if(_buffers.begin(), _buffers.end(),
+                                 [](const Buffer &b) { return !b.busy; });
+    if (free_buf == _buffers.end()) {
+      reap(1);
+      continue;
+    }
+    std::size_t n = std::min(data.size(), _buffer_sz);
+    std::memcpy(free_buf->data, data.data(), n);
+    free_buf->len = n;
+    free_buf->done = 0;
+    free_buf->off = _offset;
+    free_buf->busy = true;
+    ++_in_flight;
+    _offset += n;
+    submit(static_cast<unsigned>(free_buf - _buffers.begin()));
+    data.remove_prefix(n);
+  }
+  reap(0);
+}
+
+void IoUringSink::sync() {
+  while (_in_flight > 0)
+    reap(1);
+}
+
+void IoUringSink::submit(unsigned idx) {
+  Buffer &buf = _buffers[idx];
+  Ring &ring = *_ring;
+  unsigned tail = *ring.sq_tail;
+  unsigned slot = tail & *ring.sq_mask;
+  io_uring_sqe &sqe = ring.sqes[slot];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = ring.fixed_bufs ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+  sqe.fd = ring.fixed_file ? 0 : _fd;
+  sqe.flags = ring.fixed_file ? IOSQE_FIXED_FILE : 0;
+  sqe.addr = reinterpret_cast<std::uint64_t>(buf.data + buf.done);
+  sqe.len = static_cast<std::uint32_t>(buf.len - buf.done);
+  sqe.off = buf.off + buf.done;
+  sqe.buf_index = static_cast<std::uint16_t>(idx);
+  sqe.user_data = idx;
+  ring.sq_array[slot] = slot;
+  std::atomic_ref(*ring.sq_tail).store(tail + 1, std::memory_order_release);
+
+  while (ring.enter(1, 0, 0) < 0) {
+    if (errno == EBUSY) { // Completion queue backed up, make room first.
+      reap(0);
+    } else if (errno != EINTR && errno != EAGAIN) {
+      // Left in the ring, the entry would never complete and sync() would
+      // wait for it forever.
+      write_through();
+      return;
+    }
+  }
+}
+
+void IoUringSink::write_through() {
+  Ring &ring = *_ring;
+  unsigned head =
+      std::atomic_ref(*ring.sq_head).load(std::memory_order_acquire);
+  unsigned tail = *ring.sq_tail;
+  // The kernel only reads the ring in io_uring_enter(), which just failed:
+  // the entries past its head are ours to take back.
+  std::atomic_ref(*ring.sq_tail).store(head, std::memory_order_release);
+  for (; head != tail; ++head) {
+    const io_uring_sqe &sqe = ring.sqes[ring.sq_array[head & *ring.sq_mask]];
+    Buffer &buf = _buffers[static_cast<unsigned>(sqe.user_data)];
+    while (buf.done < buf.len) {
+      ssize_t n = ::pwrite(_fd, buf.data + buf.done, buf.len - buf.done,
+                           static_cast<off_t>(buf.off + buf.done));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break; // Failed for good, drop it like FdSink does.
+      buf.done += static_cast<std::size_t>(n);
+    }
+    buf.busy = false;
+    --_in_flight;
+  }
+}
+
+void IoUringSink::reap(unsigned min_complete) {
+  Ring &ring = *_ring;
+  if (min_complete > 0)
+    ring.enter(0, min_complete, IORING_ENTER_GETEVENTS);
+
+  std::vector<unsigned> resubmit;
+  unsigned head = *ring.cq_head;
+  unsigned tail = std::atomic_ref(*ring.cq_tail).load(std::memory_order_acquire);
+  for (; head != tail; ++head) {
+    const io_uring_cqe &cqe = ring.cqes[head & *ring.cq_mask];
+    auto idx = static_cast<unsigned>(cqe.user_data);
+    Buffer &buf = _buffers[idx];
+    if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+      resubmit.push_back(idx);
+      continue;
+    }
+    if (cqe.res > 0)
+      buf.done += static_cast<std::size_t>(cqe.res);
+    if (cqe.res > 0 && buf.done < buf.len) {
+      resubmit.push_back(idx); // Short write, queue the rest.
+    } else {
+      buf.busy = false; // Done, or failed for good and dropped.
+      --_in_flight;
+    }
+  }
+  std::atomic_ref(*ring.cq_head).store(head, std::memory_order_release);
+  for (unsigned idx : resubmit)
+    submit(idx);
+}
+
+#else
+
+struct IoUringSink::Ring {};
+
+std::unique_ptr<IoUringSink> IoUringSink::Make(int, std::size_t, unsigned) {
+  return nullptr;
+}
+
+IoUringSink::IoUringSink(int fd, std::unique_ptr<Ring> ring,
+                         std::size_t buffer_sz, std::vector<Buffer> buffers)
+    : _fd(fd), _ring(std::move(ring)), _buffer_sz(buffer_sz),
+      _buffers(std::move(buffers)), _offset(0) {}
+
+IoUringSink::~IoUringSink() { ::close(_fd); }
+
+void IoUringSink::write(std::string_view) {}
+
+void IoUringSink::sync() {}
+
+void IoUringSink::submit(unsigned) {}
+
+void IoUringSink::reap(unsigned) {}
+
+void IoUringSink::write_through() {}
+
+#endif
+
+} // namespace Spektral::Log
@@ -0,0 +1,177 @@
+#include "SlabAllocator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace Spektral::Log {
+
+namespace {
+/// Smallest block size.
+constexpr std::size_t min_block = 64;
+/// Number of size classes, min_block to SlabAllocator::max_block.
+constexpr std::size_t class_count =
+    std::countr_zero(SlabAllocator::max_block / min_block) + 1;
+/// Size of the slabs blocks are carved from.
+constexpr std::size_t slab_sz = 1 << 16;
+
+struct Cache;
+
+/// Stored in front of every allocation; the first word doubles as the free
+/// list link while the block is free.
+struct alignas(std::max_align_t) Header {
+  union {
+    Cache *owner; ///< The cache the block belongs to, nullptr if oversized
+    Header *next; ///< Next free block
+  };
+  std::uint32_t cls;
+};
+static_assert(sizeof(Header) == alignof(std::max_align_t));
+
+/// One thread's free lists and slabs.
+struct Cache {
+  /// Blocks freed by the owning thread, only touched by the owner.
+  Header *free[class_count]{};
+  /// Blocks freed by other threads.
+  std::atomic<Header *> remote[class_count]{};
+  /// Unused part of the current slab of each class.
+  char *bump[class_count]{};
+  char *bump_end[class_count]{};
+  /// Only written by the owner; atomic so that stats() can read them.
+  std::atomic<std::uint64_t> hits{0};
+  std::atomic<std::uint64_t> misses{0};
+  /// Every slab this cache carved blocks from.
+  std::vector<void *> slabs;
+};
+
+/// Every cache ever created, and the ones whose thread has exited.
+struct Registry {
+  std::mutex mtx;
+  std::vector<Cache *> all;
+  std::vector<Cache *> orphans;
+};
+
+/// Never destroyed, so that backends can still free blocks during exit.
+Registry &registry() {
+  static Registry *reg = new Registry;
+  return *reg;
+}
+
+/// The calling thread's cache, returned to the registry when it exits.
+struct CacheHandle {
+  Cache *cache = nullptr;
+  ~CacheHandle() {
+    if (!cache)
+      return;
+    Registry &reg = registry();
+    std::lock_guard lock(reg.mtx);
+    reg.orphans.push_back(cache);
+    // Blocks freed by later thread_local destructors must take the remote
+    // path, another thread may adopt the cache right away.
+    cache = nullptr;
+  }
+};
+
+thread_local CacheHandle local_cache;
+
+Cache &local() {
+  if (local_cache.cache) [[likely]]
+    return *local_cache.cache;
+  Registry &reg = registry();
+  std::lock_guard lock(reg.mtx);
+  if (!reg.orphans.empty()) {
+    local_cache.cache = reg.orphans.back();
+    reg.orphans.pop_back();
+  } else {
+    local_cache.cache = new Cache;
+    reg.all.push_back(local_cache.cache);
+  }
+  return *local_cache.cache;
+}
+
+/// Adds one to a counter only the owning thread writes.
+void bump_counter(std::atomic<std::uint64_t> &counter) {
+  counter.store(counter.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+}
+
+/// Carves a block of class cls from the cache's slab, starting a new slab if
+/// needed.
+Header *carve(Cache &cache, std::uint32_t cls) {
+  std::size_t block = min_block << cls;
+  auto left = static_cast<std::size_t>(cache.bump_end[cls] - cache.bump[cls]);
+  if (left < block) {
+    void *slab = std::malloc(slab_sz);
+    if (!slab)
+      throw std::bad_alloc();
+    cache.slabs.push_back(slab);
+    cache.bump[cls] = static_cast<char *>(slab);
+    cache.bump_end[cls] = cache.bump[cls] + slab_sz;
+  }
+  auto *hdr = reinterpret_cast<Header *>(cache.bump[cls]);
+  cache.bump[cls] += block;
+  return hdr;
+}
+} // namespace
+
+void *SlabAllocator::allocate(std::size_t sz) {
+  Cache &cache = local();
+  std::size_t total = sz + sizeof(Header);
+  if (total > max_block) {
+    bump_counter(cache.misses);
+    auto *hdr = static_cast<Header *>(::operator new(total));
+    hdr->owner = nullptr;
+    return hdr + 1;
+  }
+
+  auto cls = static_cast<std::uint32_t>(
+      std::bit_width((std::max(total, min_block) - 1) / min_block));
+  Header *hdr = cache.free[cls];
+  if (!hdr)
+    hdr = cache.remote[cls].exchange(nullptr, std::memory_order_acquire);
+  if (hdr) {
+    cache.free[cls] = hdr->next;
+    bump_counter(cache.hits);
+  } else {
+    hdr = carve(cache, cls);
+    bump_counter(cache.misses);
+  }
+  hdr->owner = &cache;
+  hdr->cls = cls;
+  return hdr + 1;
+}
+
+void SlabAllocator::deallocate(void *ptr, std::size_t) noexcept {
+  Header *hdr = static_cast<Header *>(ptr) - 1;
+  Cache *owner = hdr->owner;
+  if (!owner) {
+    ::operator delete(hdr);
+    return;
+  }
+  std::uint32_t cls = hdr->cls;
+  if (owner == local_cache.cache) {
+    hdr->next = owner->free[cls];
+    owner->free[cls] = hdr;
+    return;
+  }
+  std::atomic<Header *> &remote = owner->remote[cls];
+  hdr->next = remote.load(std::memory_order_relaxed);
+  while (!remote.compare_exchange_weak(hdr->next, hdr,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed))
+    ;
+}
+
+SlabStats SlabAllocator::stats() {
+  Registry &reg = registry();
+  std::lock_guard lock(reg.mtx);
+  SlabStats stats{0, 0};
+  for (Cache *cache : reg.all) {
+    stats.hits += cache->hits.load(std::memory_order_relaxed);
+    stats.misses += cache->misses.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+} // namespace Spektral::Log
@@ -0,0 +1,98 @@
+// Checks that every ScanWidth escapes strings the same way: for each length
+// up to max_length and each position, a string of random ordinary bytes with
+// a special byte at that position (or none) is escaped by escape_json(),
+// append_logfmt() and escape_text() at every width, and the results are
+// compared with the byte at a time scan's. Exits with 1 on a mismatch.
+
+#include "Encoders.hpp"
+#include <array>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace Spektral::Log;
+using namespace std::literals;
+
+constexpr std::size_t max_length = 100;
+constexpr int rounds = 4;
+
+/// The bytes one of the scans looks for, ' ' and '=' for logfmt.
+constexpr std::string_view specials = "\x00\x01\t\n\r\x1b\x1f\x7f\" \\="sv;
+
+/// Bytes no scan looks for, including the neighbours of the special ones and
+/// bytes with the high bit set, which a signed comparison would mistake for
+/// control characters.
+constexpr std::string_view ordinary = "!#<>[]^`az~AZ09\x80\x9f\xa0\xc3\xff";
+
+using Escape = void (*)(std::string &, std::string_view);
+
+constexpr std::array<std::pair<const char *, Escape>, 3> escapes = {{
+    {"escape_json", escape_json},
+    {"append_logfmt", append_logfmt},
+    {"escape_text", escape_text},
+}};
+
+constexpr std::array<std::pair<const char *, ScanWidth>, 2> widths = {{
+    {"AVX2", ScanWidth::AVX2},
+    {"SSE2", ScanWidth::SSE2},
+}};
+
+/// Escapes str at width.
+std::string escaped(Escape escape, ScanWidth width, std::string_view str) {
+  set_scan_width(width);
+  std::string out;
+  escape(out, str);
+  return out;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(20240501);
+  auto pick = [&rng](std::string_view bytes) {
+    return bytes[std::uniform_int_distribution<std::size_t>(
+        0, bytes.size() - 1)(rng)];
+  };
+  // Room to move the strings across alignments.
+  std::vector<char> storage(max_length + 32);
+  std::size_t checked = 0, failed = 0;
+  for (int round = 0; round < rounds; ++round) {
+    for (std::size_t length = 0; length <= max_length; ++length) {
+      // position == length: no special byte.
+      for (std::size_t position = 0; position <= length; ++position) {
+        std::size_t offset = std::uniform_int_distribution<std::size_t>(
+            0, storage.size() - length)(rng);
+        std::string_view str(storage.data() + offset, length);
+        for (std::size_t ii = 0; ii < length; ++ii)
+          storage[offset + ii] = pick(ordinary);
+        if (position < length)
+          storage[offset + position] = pick(specials);
+        // Sometimes a second one after it.
+        if (position + 1 < length && rng() % 4 == 0)
+          storage[offset + std::uniform_int_distribution<std::size_t>(
+                               position + 1, length - 1)(rng)] =
+              pick(specials);
+        for (auto [name, escape] : escapes) {
+          std::string expected = escaped(escape, ScanWidth::BYTES, str);
+          for (auto [width_name, width] : widths) {
+            ++checked;
+            if (escaped(escape, width, str) == expected)
+              continue;
+            if (++failed <= 10)
+              std::fprintf(stderr,
+                           "%s differs at width %s: length %zu, special at "
+                           "%zu, offset %zu\n",
+                           name, width_name, length, position, offset);
+          }
+        }
+      }
+    }
+  }
+  set_scan_width(ScanWidth::AVX2);
+  std::printf("%zu of %zu comparisons differ\n", failed, checked);
+  return failed ? 1 : 0;
+}
@@ -1,14 +1,47 @@
+#include "BinaryLogger.hpp"
 #include "ConsoleLogger.hpp"
 #include "FileLogger.hpp"
+#include "FrontEnd.hpp"
 #include "LogCustomErrors.hpp"
 #include "Messages.hpp"
+#include "Router.hpp"
+#include "ShardedFileLogger.hpp"
 #include "Sources.hpp"
+#include "TimestampFormatter.hpp"
 #include <benchmark/benchmark.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <format>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <new>
 #include <random>
+#include <thread>
+#include <vector>
 #define NUM_BENCH_ITERS 100000
 
+// Counts the allocations made by each thread, see BM_AllocsPerEvent.
+static thread_local std::size_t thread_allocs = 0;
+
+void *operator new(std::size_t sz) {
+  ++thread_allocs;
+  if (void *ptr = std::malloc(sz ? sz : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+// The insert benchmarks queue up to 100000 events per thread faster than the
+// backend writes them: their lanes hold a whole run.
+static const Spektral::Log::FileOptions burst_lanes{.lane_events = 1 << 17};
+
 void BM_MakeSrc(benchmark::State &state) {
   for (auto _ : state) {
     Spektral::Log::Source<std::string>::Make("main");
@@ -21,13 +54,38 @@ void BM_MakeMessage(benchmark::State &state) {
   }
 }
 
+void BM_MakeFormatMessage(benchmark::State &state) {
+  for (auto _ : state) {
+    Spektral::Log::make_message<"main">();
+  }
+}
+
 void BM_Console(benchmark::State &state) {
   Spektral::Log::ConsoleLogger &cl =
-      Spektral::Log::ConsoleLogger::get_inst(Spektral::Log::INFO);
+      Spektral::Log::ConsoleLogger::get_inst(Spektral::Log::LogLevel::INFO);
   Spektral::Log::FileLogger logger("output_logs/demo.log");
+  // The terminal is slower than the producer: wait for room rather than
+  // ending the run when the lane fills.
+  for (const auto &_ : state) {
+    for (;;) {
+      try {
+        cl.insert({Spektral::Log::LogLevel::INFO,
+                   Spektral::Log::Source<std::string>::Make("main"),
+                   Spektral::Log::Message<std::string>::Make("Hi")});
+        break;
+      } catch (Spektral::Log::full_queue_exception &e) {
+        std::this_thread::yield();
+      }
+    }
+  }
+}
+
+static Spektral::Log::FileLogger logger("output_logs/demo.log",
+                                         burst_lanes);
+void BM_File(benchmark::State &state) {
   for (const auto &_ : state) {
     try {
-      cl.insert({Spektral::Log::INFO,
+      logger.insert({Spektral::Log::LogLevel::INFO,
                      Spektral::Log::Source<std::string>::Make("main"),
                      Spektral::Log::Message<std::string>::Make("Hi")});
     } catch (Spektral::Log::full_queue_exception &e) {
@@ -36,21 +94,594 @@ void BM_Console(benchmark::State &state) {
   }
 }
 
-static Spektral::Log::FileLogger logger("output_logs/demo.log");
-void BM_File(benchmark::State &state) {
+static Spektral::Log::BinaryLogger bin_logger("output_logs/demo.bin");
+void BM_Binary(benchmark::State &state) {
   for (const auto &_ : state) {
     try {
-      logger.insert({Spektral::Log::INFO,
-                     Spektral::Log::Source<std::string>::Make("main"),
-                     Spektral::Log::Message<std::string>::Make("Hi")});
+      SPEKTRAL_BINLOG(bin_logger, Spektral::Log::LogLevel::INFO, "main", "Hi");
     } catch (Spektral::Log::full_queue_exception &e) {
       return;
     }
   }
 }
 
+void BM_BinaryArgs(benchmark::State &state) {
+  for (const auto &_ : state) {
+    try {
+      SPEKTRAL_BINLOG(bin_logger, Spektral::Log::LogLevel::INFO, "main",
+                      "sent {} bytes to {} in {}ms", 1500, "10.0.0.1", 0.25);
+    } catch (Spektral::Log::full_queue_exception &e) {
+      return;
+    }
+  }
+}
+
+// Cost of one timestamp. Arg is the ClockSource.
+void BM_Clock(benchmark::State &state) {
+  auto source = static_cast<Spektral::Log::ClockSource>(state.range(0));
+  Spektral::Log::Clock clock(source);
+  if (clock.source() != source) {
+    state.SkipWithError("TSC unavailable");
+    return;
+  }
+  for (const auto &_ : state)
+    benchmark::DoNotOptimize(clock.now());
+}
+
+// emplace() with each ClockSource, to compare against BM_File.
+void BM_FileClock(benchmark::State &state) {
+  using namespace Spektral::Log;
+  FileLogger cl("output_logs/demo_clock.log",
+                {.clock = static_cast<ClockSource>(state.range(0)),
+                 .lane_events = burst_lanes.lane_events});
+  for (const auto &_ : state) {
+    try {
+      cl.emplace(LogLevel::INFO, Source<std::string>("main"),
+                 Message<std::string>("Hi"));
+    } catch (full_queue_exception &e) {
+      state.SkipWithError(e.what());
+      break;
+    }
+  }
+}
+
+// Cost of rendering one timestamp, 1us after the previous one.
+// Arg 0: std::format("{}", time). Arg 1: TimestampFormatter.
+void BM_Timestamp(benchmark::State &state) {
+  using namespace Spektral::Log;
+  TimestampFormatter ts;
+  std::string out;
+  std_time_t time = std_clock::now();
+  for (const auto &_ : state) {
+    time += std::chrono::microseconds(1);
+    out.clear();
+    if (state.range(0) == 0)
+      std::format_to(std::back_inserter(out), "{}", time);
+    else
+      ts.format_to(out, time);
+    benchmark::DoNotOptimize(out.data());
+  }
+}
+
+// Backend cost of formatting one event into the batch buffer.
+// Arg 0: buffer += operator std::string(). Arg 1: format_to(buffer).
+void BM_FormatEvent(benchmark::State &state) {
+  using namespace Spektral::Log;
+  LogEvent event{LogLevel::INFO, Source<std::string>("main"),
+                 make_message<"sent {} bytes to {}">(1500, "10.0.0.1")};
+  TimestampFormatter ts;
+  std::string buffer;
+  buffer.reserve(1 << 16);
+  for (const auto &_ : state) {
+    buffer.clear();
+    if (state.range(0) == 0)
+      buffer += event.to_string(ts);
+    else
+      event.format_to(buffer, ts);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+}
+
+// Cost of logging a JSON line, building the event included.
+// Arg 0: the caller formats the JSON into a Message<std::string>, the backend
+// writes it as text. Arg 1: a StructuredMessage encoded as JSON by the
+// backend. Arg 2: the same, encoded as logfmt.
+void BM_Structured(benchmark::State &state) {
+  using namespace Spektral::Log;
+  Encoder encoder(static_cast<OutputFormat>(state.range(0)));
+  std::string host = "10.0.0.1";
+  std::string buffer;
+  buffer.reserve(1 << 16);
+  for (const auto &_ : state) {
+    buffer.clear();
+    if (state.range(0) == 0) {
+      LogEvent event{LogLevel::INFO, "main",
+                     Message<std::string>(std::format(
+                         "{{\"msg\":\"sent\",\"bytes\":{},\"host\":\"{}\"}}",
+                         1500, host))};
+      encoder.encode(buffer, event);
+    } else {
+      LogEvent event{LogLevel::INFO, "main",
+                     make_structured<"sent">(field<"bytes">(1500),
+                                             field<"host">(host))};
+      encoder.encode(buffer, event);
+    }
+    benchmark::DoNotOptimize(buffer.data());
+  }
+}
+
+// Escaping a typical log payload of range(0) bytes, without anything to
+// escape. Arg 1: 0 for escape_json(), 1 for escape_text().
+void BM_Escape(benchmark::State &state) {
+  using namespace Spektral::Log;
+  std::string payload;
+  while (payload.size() < static_cast<std::size_t>(state.range(0)))
+    payload += "user 4711 fetched /api/v2/orders?page=3 in 12ms; ";
+  payload.resize(state.range(0));
+  std::string buffer;
+  buffer.reserve(1 << 16);
+  for (const auto &_ : state) {
+    buffer.clear();
+    if (state.range(1) == 0)
+      escape_json(buffer, payload);
+    else
+      escape_text(buffer, payload);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+// Backend cost of an event with a 128 byte message in OutputFormat
+// range(0): TEXT (0) or ESCAPED_TEXT (3). Arg 1: whether the message holds a
+// newline.
+void BM_EscapedText(benchmark::State &state) {
+  using namespace Spektral::Log;
+  std::string message(128, 'x');
+  if (state.range(1))
+    message[100] = '\n';
+  LogEvent event{LogLevel::INFO, "main", message};
+  Encoder encoder(static_cast<OutputFormat>(state.range(0)));
+  std::string buffer;
+  buffer.reserve(1 << 16);
+  for (const auto &_ : state) {
+    buffer.clear();
+    encoder.encode(buffer, event);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+}
+
+// Backend cost of formatting a batch of events with an int message.
+// Arg 0: Source<std::string> and Message<int> (virtual calls).
+// Arg 1: "main" and an int (held by Payload, no virtual call).
+void BM_FormatPayload(benchmark::State &state) {
+  using namespace Spektral::Log;
+  std::vector<LogEvent> batch;
+  for (int ii = 0; ii < 1024; ++ii) {
+    if (state.range(0) == 0)
+      batch.push_back(
+          {LogLevel::INFO, Source<std::string>("main"), Message<int>(ii)});
+    else
+      batch.push_back({LogLevel::INFO, "main", ii});
+  }
+  TimestampFormatter ts;
+  std::string buffer;
+  buffer.reserve(1 << 17);
+  for (const auto &_ : state) {
+    buffer.clear();
+    for (auto &event : batch)
+      event.format_to(buffer, ts);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations() * 1024);
+}
+
+// Cost of a log call filtered out at runtime (INFO below WARN).
+// Arg 0: building the source and message, then a Router dropping them. (The
+// console singleton keeps the level it was first created with, INFO here.)
+// Arg 1: SPEKTRAL_INFO, which stops at FrontEnd::enabled().
+void BM_Filtered(benchmark::State &state) {
+  using namespace Spektral::Log;
+  Router router;
+  router.add(ConsoleLogger::get_inst(), LogLevel::WARN);
+  FrontEnd &fe = get_log();
+  fe.set_level(LogLevel::WARN);
+  for (const auto &_ : state) {
+    if (state.range(0) == 0)
+      router.log(LogLevel::INFO, Source<std::string>::Make("main"),
+                 Message<std::string>::Make("Hi"));
+    else
+      SPEKTRAL_INFO("main", "Hi {}", std::string("there"));
+  }
+}
+
+// ConsoleLogger::get_inst() from several threads at once: after the first
+// call, only the function-local static's guard check.
+void BM_ConsoleGetInst(benchmark::State &state) {
+  using namespace Spektral::Log;
+  for (const auto &_ : state)
+    benchmark::DoNotOptimize(&ConsoleLogger::get_inst());
+}
+
+// Several threads logging to the console at once, one event in 64 an ERROR:
+// the cost of the shared sequence number.
+void BM_ConsoleMT(benchmark::State &state) {
+  using namespace Spektral::Log;
+  ConsoleLogger &cl = ConsoleLogger::get_inst(LogLevel::INFO);
+  std::size_t ii = 0;
+  for (const auto &_ : state) {
+    LogLevel level = ++ii % 64 ? LogLevel::INFO : LogLevel::ERROR;
+    // Wait for room, as in BM_Console.
+    for (;;) {
+      try {
+        cl.emplace(level, "main", "Hi");
+        break;
+      } catch (full_queue_exception &e) {
+        std::this_thread::yield();
+      }
+    }
+  }
+}
+
+// One event sent to two loggers.
+// Arg 0: the caller builds and inserts one LogEvent per logger.
+// Arg 1: a Router shares one source and message between them.
+static Spektral::Log::FileLogger route_a("output_logs/demo_route_a.log",
+                                          burst_lanes);
+static Spektral::Log::FileLogger route_b("output_logs/demo_route_b.log",
+                                          burst_lanes);
+void BM_Router(benchmark::State &state) {
+  using namespace Spektral::Log;
+  Router router;
+  router.add(route_a, LogLevel::INFO);
+  router.add(route_b, LogLevel::INFO);
+  std::string host = "host-with-a-name-too-long-for-sso.example.com";
+  for (const auto &_ : state) {
+    try {
+      if (state.range(0) == 0) {
+        route_a.insert({LogLevel::INFO, Source<std::string>("main"),
+                        make_message<"connected to {}">(host)});
+        route_b.insert({LogLevel::INFO, Source<std::string>("main"),
+                        make_message<"connected to {}">(host)});
+      } else {
+        router.log(LogLevel::INFO, Source<std::string>("main"),
+                   make_message<"connected to {}">(host));
+      }
+    } catch (full_queue_exception &e) {
+      state.SkipWithError(e.what());
+      break;
+    }
+  }
+}
+
+// Heap allocations made by the logging thread per event.
+// Arg 0: source and message passed by value (stored inline in the event).
+// Arg 1: source and message passed through Make().
+static Spektral::Log::FileLogger alloc_logger("output_logs/demo_alloc.log",
+                                               burst_lanes);
+void BM_AllocsPerEvent(benchmark::State &state) {
+  using namespace Spektral::Log;
+  auto make_event = [by_value = state.range(0) == 0]() -> LogEvent {
+    if (by_value)
+      return {LogLevel::INFO, Source<std::string>("main"),
+              Message<std::string>("Hi")};
+    return {LogLevel::INFO, Source<std::string>::Make("main"),
+            Message<std::string>::Make("Hi")};
+  };
+  // Registers this thread's lane before counting.
+  alloc_logger.insert(make_event());
+  std::size_t before = thread_allocs;
+  for (const auto &_ : state) {
+    try {
+      alloc_logger.insert(make_event());
+    } catch (Spektral::Log::full_queue_exception &e) {
+      state.SkipWithError(e.what());
+      break;
+    }
+  }
+  state.counters["allocs_per_event"] =
+      static_cast<double>(thread_allocs - before) /
+      static_cast<double>(state.iterations());
+}
+
+// A message too large to be stored inline, see BM_LargePayload.
+struct LargePayload {
+  std::array<char, 2048> bytes{};
+  operator std::string() const { return std::string(bytes.data(), 16); }
+};
+
+// Logs messages of 2KB, which come from the calling thread's slabs and are
+// recycled by the backend. Reports the logging thread's heap allocations and
+// the slab hit rate.
+void BM_LargePayload(benchmark::State &state) {
+  using namespace Spektral::Log;
+  LargePayload payload;
+  auto before_stats = SlabAllocator::stats();
+  std::size_t before = thread_allocs;
+  for (const auto &_ : state) {
+    try {
+      alloc_logger.insert({LogLevel::INFO, Source<std::string>("main"),
+                           Message<LargePayload>(payload)});
+    } catch (Spektral::Log::full_queue_exception &e) {
+      state.SkipWithError(e.what());
+      break;
+    }
+  }
+  auto stats = SlabAllocator::stats();
+  auto hits = static_cast<double>(stats.hits - before_stats.hits);
+  auto misses = static_cast<double>(stats.misses - before_stats.misses);
+  state.counters["allocs_per_event"] =
+      static_cast<double>(thread_allocs - before) /
+      static_cast<double>(state.iterations());
+  state.counters["slab_hit_pct"] = 100.0 * hits / (hits + misses);
+}
+
+static Spektral::Log::FileLogger mt_logger("output_logs/demo_mt.log",
+                                            burst_lanes);
+void BM_FileMT(benchmark::State &state) {
+  for (const auto &_ : state) {
+    try {
+      mt_logger.insert({Spektral::Log::LogLevel::INFO,
+                        Spektral::Log::Source<std::string>::Make("main"),
+                        Spektral::Log::Message<std::string>::Make("Hi")});
+    } catch (Spektral::Log::full_queue_exception &e) {
+      state.SkipWithError(e.what());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// End-to-end file throughput: insert a burst of events and wait until the
+// backend has written all of them. Args are FileOptions::batch_events,
+// FileOptions::batch_bytes and FileOptions::backend; {1, 1, 0} is one write(2)
+// per event.
+void BM_FileDrain(benchmark::State &state) {
+  const std::size_t burst = 100000;
+  Spektral::Log::FileOptions opts{
+      .batch_events = static_cast<std::size_t>(state.range(0)),
+      .batch_bytes = static_cast<std::size_t>(state.range(1)),
+      .backend = static_cast<Spektral::Log::FileBackend>(state.range(2)),
+      .overflow = Spektral::Log::OverflowPolicy::BLOCK};
+  for (const auto &_ : state) {
+    Spektral::Log::FileLogger dl("output_logs/drain.log", opts);
+    for (std::size_t ii = 0; ii < burst; ++ii)
+      dl.insert({Spektral::Log::LogLevel::INFO,
+                 Spektral::Log::Source<std::string>::Make("main"),
+                 Spektral::Log::Message<std::string>::Make("Hi")});
+  }
+  state.SetItemsProcessed(state.iterations() * burst);
+}
+
+// End-to-end throughput of a burst written to a file rotated every 1MiB.
+// range(0): 0 never rotates, 1 rotates, 2 rotates and compresses.
+void BM_FileRotate(benchmark::State &state) {
+  const std::size_t burst = 100000;
+  Spektral::Log::FileOptions opts{
+      .overflow = Spektral::Log::OverflowPolicy::BLOCK,
+      .rotate_bytes = state.range(0) ? std::size_t{1} << 20 : 0,
+      .retain = 4,
+      .compress = state.range(0) == 2};
+  for (const auto &_ : state) {
+    Spektral::Log::FileLogger rl("output_logs/rotate.log", opts);
+    for (std::size_t ii = 0; ii < burst; ++ii)
+      rl.emplace(Spektral::Log::LogLevel::INFO, "main",
+                 Spektral::Log::make_message<"event {}">(ii));
+  }
+  state.SetItemsProcessed(state.iterations() * burst);
+}
+
+// End-to-end throughput of a burst compressed with codec range(0), see
+// Compression, and the size of the file it leaves.
+void BM_FileCompress(benchmark::State &state) {
+  using Spektral::Log::Compression;
+  const std::size_t burst = 100000;
+  auto codec = static_cast<Compression>(state.range(0));
+  if (codec != Compression::NONE &&
+      !Spektral::Log::Compressor::available(codec)) {
+    state.SkipWithError("codec unavailable");
+    return;
+  }
+  Spektral::Log::FileOptions opts{
+      .overflow = Spektral::Log::OverflowPolicy::BLOCK, .compression = codec};
+  for (const auto &_ : state) {
+    Spektral::Log::FileLogger cl("output_logs/compress.log", opts);
+    for (std::size_t ii = 0; ii < burst; ++ii)
+      cl.emplace(Spektral::Log::LogLevel::INFO, "main",
+                 Spektral::Log::make_message<"event {}">(ii));
+  }
+  state.SetItemsProcessed(state.iterations() * burst);
+  state.counters["file_bytes"] = static_cast<double>(
+      std::filesystem::file_size("output_logs/compress.log"));
+}
+
+// Bytes written per event by a backend that flushes after every event or
+// two, as under light traffic, with compression range(0).
+void BM_FileCompressTrickle(benchmark::State &state) {
+  using Spektral::Log::Compression;
+  const std::size_t events = 2000;
+  auto codec = static_cast<Compression>(state.range(0));
+  if (codec != Compression::NONE &&
+      !Spektral::Log::Compressor::available(codec)) {
+    state.SkipWithError("codec unavailable");
+    return;
+  }
+  for (const auto &_ : state) {
+    Spektral::Log::FileLogger cl("output_logs/trickle.log",
+                                 {.compression = codec});
+    for (std::size_t ii = 0; ii < events; ++ii) {
+      cl.emplace(Spektral::Log::LogLevel::INFO, "main",
+                 Spektral::Log::make_message<"event {}">(ii));
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * events);
+  state.counters["bytes_per_event"] =
+      static_cast<double>(
+          std::filesystem::file_size("output_logs/trickle.log")) /
+      events;
+}
+
+// End-to-end throughput of 4 threads logging a burst each into range(0)
+// shards, until every shard has written its events.
+void BM_ShardedDrain(benchmark::State &state) {
+  const std::size_t burst = 100000, threads = 4;
+  for (const auto &_ : state) {
+    Spektral::Log::ShardedFileLogger sl(
+        "output_logs/sharded.log", static_cast<std::size_t>(state.range(0)),
+        Spektral::Log::ShardBy::THREAD,
+        {.overflow = Spektral::Log::OverflowPolicy::BLOCK});
+    std::vector<std::thread> producers;
+    for (std::size_t tt = 0; tt < threads; ++tt)
+      producers.emplace_back([&sl, burst] {
+        for (std::size_t ii = 0; ii < burst; ++ii)
+          sl.emplace(Spektral::Log::LogLevel::INFO, "main",
+                     Spektral::Log::make_message<"event {}">(ii));
+      });
+    for (auto &producer : producers)
+      producer.join();
+  }
+  state.SetItemsProcessed(state.iterations() * threads * burst);
+}
+
+// A burst of 4 * LOG_LANE_SZ events from one thread, far more than its lane
+// holds, under each overflow policy but THROW.
+void BM_Overflow(benchmark::State &state) {
+  auto policy = static_cast<Spektral::Log::OverflowPolicy>(state.range(0));
+  const std::size_t burst = 4 * LOG_LANE_SZ;
+  std::uint64_t dropped = 0;
+  for (const auto &_ : state) {
+    Spektral::Log::FileLogger ol("output_logs/overflow.log",
+                                 {.overflow = policy});
+    for (std::size_t ii = 0; ii < burst; ++ii)
+      ol.emplace(ii % 16 ? Spektral::Log::LogLevel::INFO
+                         : Spektral::Log::LogLevel::ERROR,
+                 "main", "Hi");
+    dropped += ol.dropped();
+  }
+  state.SetItemsProcessed(state.iterations() * burst);
+  state.counters["dropped_pct"] =
+      100.0 * static_cast<double>(dropped) /
+      static_cast<double>(state.iterations() * burst);
+}
+
+// Records when the backend converts it to a string, i.e. when the backend
+// thread picked the event up.
+class StampSource : public Spektral::Log::ISource {
+  std::atomic<std::int64_t> *seen;
+
+public:
+  explicit StampSource(std::atomic<std::int64_t> *s) : seen(s) {}
+  operator std::string() override {
+    seen->store(std::chrono::steady_clock::now().time_since_epoch().count());
+    return "stamp";
+  }
+};
+
+// Time from insert() on an idle logger until its backend handles the event.
+void BM_WakeLatency(benchmark::State &state) {
+  auto wait = static_cast<Spektral::Log::WaitStrategy>(state.range(0));
+  Spektral::Log::FileLogger wl("output_logs/wake.log", wait);
+  std::atomic<std::int64_t> seen{0};
+  for (const auto &_ : state) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    seen = 0;
+    auto start = std::chrono::steady_clock::now();
+    wl.insert({Spektral::Log::LogLevel::INFO, std::make_unique<StampSource>(&seen),
+               Spektral::Log::Message<std::string>::Make("Hi")});
+    while (seen == 0)
+      ;
+    std::chrono::duration<double> elapsed(
+        std::chrono::steady_clock::duration(seen) - start.time_since_epoch());
+    state.SetIterationTime(elapsed.count());
+  }
+}
+
+// CPU used by the process while a logger sits idle, as a % of one core.
+void BM_IdleCpu(benchmark::State &state) {
+  auto wait = static_cast<Spektral::Log::WaitStrategy>(state.range(0));
+  Spektral::Log::FileLogger il("output_logs/idle.log", wait);
+  std::clock_t cpu = 0;
+  double wall = 0;
+  for (const auto &_ : state) {
+    auto start = std::chrono::steady_clock::now();
+    std::clock_t cpu_start = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    cpu += std::clock() - cpu_start;
+    wall += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          start)
+                .count();
+  }
+  state.counters["idle_cpu_pct"] =
+      100.0 * (static_cast<double>(cpu) / CLOCKS_PER_SEC) / wall;
+}
+
 BENCHMARK(BM_MakeSrc);
 BENCHMARK(BM_MakeMessage);
+BENCHMARK(BM_MakeFormatMessage);
 BENCHMARK(BM_Console);
 BENCHMARK(BM_File)->Iterations(100000);
+BENCHMARK(BM_Binary)->Iterations(100000);
+BENCHMARK(BM_BinaryArgs)->Iterations(100000);
+BENCHMARK(BM_Clock)->ArgName("clock")->DenseRange(0, 2);
+BENCHMARK(BM_FileClock)->ArgName("clock")->DenseRange(0, 2)->Iterations(100000);
+BENCHMARK(BM_Timestamp)->ArgName("cached")->Arg(0)->Arg(1);
+BENCHMARK(BM_FormatEvent)->ArgName("format_to")->Arg(0)->Arg(1);
+BENCHMARK(BM_Structured)->ArgName("format")->DenseRange(0, 2);
+BENCHMARK(BM_Escape)
+    ->Args({32, 0})
+    ->Args({128, 0})
+    ->Args({512, 0})
+    ->Args({4096, 0})
+    ->Args({128, 1})
+    ->Args({4096, 1});
+BENCHMARK(BM_EscapedText)->Args({0, 0})->Args({3, 0})->Args({3, 1});
+BENCHMARK(BM_FormatPayload)->ArgName("builtin")->Arg(0)->Arg(1);
+BENCHMARK(BM_Filtered)->ArgName("frontend")->Arg(0)->Arg(1);
+BENCHMARK(BM_ConsoleGetInst)->ThreadRange(1, 8);
+BENCHMARK(BM_ConsoleMT)->Iterations(10000)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_Router)->ArgName("router")->Arg(0)->Arg(1)->Iterations(100000);
+BENCHMARK(BM_AllocsPerEvent)
+    ->ArgName("make")
+    ->Arg(0)
+    ->Arg(1)
+    ->Iterations(100000);
+BENCHMARK(BM_LargePayload)->Iterations(100000);
+BENCHMARK(BM_FileMT)->Iterations(10000)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_FileDrain)
+    ->Args({1, 1, 0})
+    ->Args({1024, 1 << 16, 0})
+    ->Args({1024, 1 << 16, 1})
+    ->Args({1024, 1 << 16, 2})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FileRotate)
+    ->ArgName("rotate")
+    ->DenseRange(0, 2)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FileCompress)
+    ->ArgName("codec")
+    ->DenseRange(0, 2)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FileCompressTrickle)
+    ->ArgName("codec")
+    ->DenseRange(0, 2)
+    ->Iterations(3)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ShardedDrain)
+    ->ArgName("shards")
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Overflow)
+    ->ArgName("policy")
+    ->DenseRange(1, 4)
+    ->Iterations(5)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WakeLatency)
+    ->ArgName("wait")
+    ->DenseRange(0, 3)
+    ->Iterations(200)
+    ->UseManualTime();
+BENCHMARK(BM_IdleCpu)->ArgName("wait")->DenseRange(0, 3)->Iterations(10);
 BENCHMARK_MAIN();
@@ -0,0 +1,101 @@
+// Checks TimestampFormatter against gmtime_r() and strftime(): random
+// timestamps from 1700 to 2261, followed by runs of nearby ones that hit and
+// miss its cache (the same second, the next second or minute, a step back),
+// are formatted in every TimestampFormat and TimestampPrecision and compared
+// with what the C library renders. Exits with 1 on a mismatch.
+
+#include "TimestampFormatter.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace Spektral::Log;
+
+constexpr int samples = 20000;
+
+constexpr std::array<TimestampFormat, 3> formats = {
+    TimestampFormat::DEFAULT, TimestampFormat::ISO8601,
+    TimestampFormat::EPOCH_NS};
+
+constexpr std::array<TimestampPrecision, 4> precisions = {
+    TimestampPrecision::SECONDS, TimestampPrecision::MILLIS,
+    TimestampPrecision::MICROS, TimestampPrecision::NANOS};
+
+/// What TimestampFormatter should write for ns nanoseconds since the epoch.
+std::string expected(std::int64_t ns, TimestampFormat format,
+                     TimestampPrecision precision) {
+  if (format == TimestampFormat::EPOCH_NS)
+    return std::to_string(ns);
+  std::int64_t second = ns / 1'000'000'000, frac = ns % 1'000'000'000;
+  if (frac < 0) {
+    --second;
+    frac += 1'000'000'000;
+  }
+  auto time = static_cast<std::time_t>(second);
+  std::tm tm;
+  ::gmtime_r(&time, &tm);
+  char buf[64];
+  std::size_t len = std::strftime(buf, sizeof(buf),
+                                  format == TimestampFormat::ISO8601
+                                      ? "%Y-%m-%dT%H:%M:%S"
+                                      : "%Y-%m-%d %H:%M:%S",
+                                  &tm);
+  std::string out(buf, len);
+  if (auto digits = static_cast<int>(precision)) {
+    std::snprintf(buf, sizeof(buf), ".%09lld", static_cast<long long>(frac));
+    out.append(buf, 1 + digits);
+  }
+  if (format == TimestampFormat::ISO8601)
+    out += 'Z';
+  return out;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937_64 rng(20240501);
+  // 1700-01-01 to 2261-01-01, within what nanoseconds in an int64 reach.
+  std::uniform_int_distribution<std::int64_t> anytime(-8'520'336'000LL,
+                                                      9'183'110'400LL);
+  std::uniform_int_distribution<std::int64_t> fraction(0, 999'999'999);
+  std::vector<std::int64_t> times;
+  for (int ii = 0; ii < samples; ++ii) {
+    std::int64_t ns = anytime(rng) * 1'000'000'000 + fraction(rng);
+    times.push_back(ns);
+    // Nearby steps, as consecutive events take them.
+    for (std::int64_t step : {0LL, 1'000LL, 999'999'999LL, 1'000'000'000LL,
+                              59'000'000'000LL, 60'000'000'000LL,
+                              -1'000'000'000LL, 3'600'000'000'000LL}) {
+      ns += step;
+      times.push_back(ns);
+    }
+  }
+
+  std::size_t checked = 0, failed = 0;
+  for (TimestampFormat format : formats) {
+    for (TimestampPrecision precision : precisions) {
+      TimestampFormatter formatter(format, precision);
+      for (std::int64_t ns : times) {
+        std_time_t time{std::chrono::duration_cast<std_time_t::duration>(
+            std::chrono::nanoseconds(ns))};
+        std::string want = expected(ns, format, precision);
+        std::string got = formatter.format(time);
+        ++checked;
+        if (got == want)
+          continue;
+        if (++failed <= 10)
+          std::fprintf(stderr, "%lld: got \"%s\", expected \"%s\"\n",
+                       static_cast<long long>(ns), got.c_str(), want.c_str());
+      }
+    }
+  }
+  std::printf("%zu of %zu timestamps differ\n", failed, checked);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,486 @@
+/// @file: tools/logdecode.cpp
+/// @brief: turns BinaryLogger files back into the text FileLogger writes.
+///
+/// Usage: logdecode <input.bin> [-o <output>] [-j <threads>]
+///
+/// The file is mapped, its chunk headers are indexed and its DICT chunks are
+/// read up front. EVENTS chunks are then decoded in parallel, each into its own
+/// buffer, and written out in file order. Within a chunk events are ordered by
+/// timestamp, like FileLogger orders each batch.
+
+#include "BinaryLogger.hpp"
+#include "TimestampFormatter.hpp"
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Bin = Spektral::Log::Binary;
+using Spektral::Log::LogLevel;
+
+namespace {
+
+/// A decoded argument, formatted through std::formatter<Arg>.
+struct Arg {
+  Bin::ArgTag tag;
+  union {
+    std::int64_t i64;
+    std::uint64_t u64;
+    double f64;
+    bool b;
+    char c;
+  };
+  std::string_view str;
+};
+
+} // namespace
+
+/**
+ * @brief Formats an Arg with the standard formatter of the type it was logged
+ * as.
+ *
+ * The type is only known once the value is, so parse() keeps the format spec
+ * and format() hands it to the real formatter. Nested replacement fields
+ * (dynamic width or precision) are not supported.
+ */
+template <> struct std::formatter<Arg> {
+  constexpr auto parse(std::format_parse_context &pc) {
+    auto it = pc.begin();
+    while (it != pc.end() && *it != '}')
+      ++it;
+    _spec = std::string_view(pc.begin(), it);
+    return it;
+  }
+
+  std::format_context::iterator format(const Arg &arg,
+                                      std::format_context &ctx) const {
+    using enum Bin::ArgTag;
+    switch (arg.tag) {
+    case I64:
+      return format_as(arg.i64, ctx);
+    case U64:
+      return format_as(arg.u64, ctx);
+    case F64:
+      return format_as(arg.f64, ctx);
+    case BOOL:
+      return format_as(arg.b, ctx);
+    case CHAR:
+      return format_as(arg.c, ctx);
+    case STR:
+      return format_as(arg.str, ctx);
+    }
+    throw std::format_error("argument index out of range");
+  }
+
+private:
+  template <typename T>
+  std::format_context::iterator format_as(const T &val,
+                                          std::format_context &ctx) const {
+    std::formatter<T> fmt;
+    std::format_parse_context pc(_spec);
+    pc.advance_to(fmt.parse(pc));
+    return fmt.format(val, ctx);
+  }
+
+  std::string_view _spec;
+};
+
+namespace {
+
+/// Bounds-checked reader over a byte range.
+class Reader {
+public:
+  Reader(const char *begin, std::size_t size)
+      : _pos(begin), _end(begin + size) {}
+
+  template <typename T> T get() {
+    T val;
+    std::memcpy(&val, take(sizeof(T)), sizeof(T));
+    return val;
+  }
+
+  std::string_view bytes(std::size_t n) { return {take(n), n}; }
+
+private:
+  const char *take(std::size_t n) {
+    if (static_cast<std::size_t>(_end - _pos) < n)
+      throw std::runtime_error("Truncated record");
+    const char *at = _pos;
+    _pos += n;
+    return at;
+  }
+
+  const char *_pos;
+  const char *_end;
+};
+
+/// Format strings by id.
+using Dictionary = std::unordered_map<std::uint64_t, std::string_view>;
+
+/// A decoded event waiting to be formatted.
+struct Event {
+  Bin::EventHeader hdr;
+  std::string_view source;
+  std::string_view args; ///< Encoded arguments
+};
+
+/// Formats fmt with the first N entries of args.
+template <std::size_t N>
+void vformat_n(std::string &out, std::string_view fmt, Arg *args) {
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    std::vformat_to(std::back_inserter(out), fmt,
+                    std::make_format_args(args[I]...));
+  }(std::make_index_sequence<N>{});
+}
+
+/// Appends fmt formatted with nargs arguments to out. std::format ignores
+/// unused trailing arguments, so nargs is rounded up to a few fixed sizes and
+/// the padding is marked as missing.
+void format_message(std::string &out, std::string_view fmt, Arg *args,
+                    std::size_t nargs) {
+  std::size_t padded = nargs <= 4    ? 4
+                       : nargs <= 16 ? 16
+                       : nargs <= 64 ? 64
+                                     : 256;
+  for (std::size_t ii = nargs; ii < padded; ++ii)
+    args[ii].tag = Bin::ArgTag{};
+  switch (padded) {
+  case 4:
+    return vformat_n<4>(out, fmt, args);
+  case 16:
+    return vformat_n<16>(out, fmt, args);
+  case 64:
+    return vformat_n<64>(out, fmt, args);
+  default:
+    return vformat_n<256>(out, fmt, args);
+  }
+}
+
+/// Decodes the encoded arguments of an event into args.
+void decode_args(Reader args_in, std::size_t nargs, Arg *args) {
+  for (std::size_t ii = 0; ii < nargs; ++ii) {
+    Arg &arg = args[ii];
+    arg.tag = args_in.get<Bin::ArgTag>();
+    switch (arg.tag) {
+      using enum Bin::ArgTag;
+    case I64:
+      arg.i64 = args_in.get<std::int64_t>();
+      break;
+    case U64:
+      arg.u64 = args_in.get<std::uint64_t>();
+      break;
+    case F64:
+      arg.f64 = args_in.get<double>();
+      break;
+    case BOOL:
+      arg.b = args_in.get<char>() != 0;
+      break;
+    case CHAR:
+      arg.c = args_in.get<char>();
+      break;
+    case STR:
+      arg.str = args_in.bytes(args_in.get<std::uint32_t>());
+      break;
+    default:
+      throw std::runtime_error("Unknown argument type");
+    }
+  }
+}
+
+/// Appends the text of one event, matching LogEvent::operator std::string().
+void format_event(std::string &out, const Event &ev, const Dictionary &dict,
+                  Arg *args, Spektral::Log::TimestampFormatter &ts) {
+  using namespace std::chrono;
+  Spektral::Log::std_time_t time(
+      duration_cast<Spektral::Log::std_clock::duration>(
+          nanoseconds(ev.hdr.time_ns)));
+  std::string_view from = " from ";
+  switch (ev.hdr.level) {
+    using enum LogLevel;
+  case INFO:
+    out += "INFO: ";
+    break;
+  case WARN:
+    out += "WARN: ";
+    break;
+  case DEBUG:
+    out += "DEBUG: ";
+    break;
+  case ERROR:
+    out += "ERROR: ";
+    break;
+  default:
+    out += "UNKOWN_LEVEL: ";
+    from = " ";
+    break;
+  }
+  ts.format_to(out, time);
+  out += ' ';
+
+  auto fmt = dict.find(ev.hdr.fmt_id);
+  if (fmt == dict.end()) {
+    std::format_to(std::back_inserter(out), "<unknown format {:#x}>",
+                   ev.hdr.fmt_id);
+  } else {
+    std::size_t mark = out.size();
+    try {
+      decode_args(Reader(ev.args.data(), ev.args.size()), ev.hdr.nargs, args);
+      format_message(out, fmt->second, args, ev.hdr.nargs);
+    } catch (const std::exception &e) {
+      out.resize(mark);
+      std::format_to(std::back_inserter(out), "<{}: {}>", e.what(),
+                     fmt->second);
+    }
+  }
+  out += from;
+  out += ev.source;
+  out += '\n';
+}
+
+/// Decodes an EVENTS chunk payload into text.
+std::string decode_chunk(std::string_view payload, std::uint32_t records,
+                         const Dictionary &dict) {
+  std::vector<Event> events;
+  events.reserve(records);
+  Reader in(payload.data(), payload.size());
+  for (std::uint32_t ii = 0; ii < records; ++ii) {
+    std::string_view body = in.bytes(in.get<std::uint32_t>());
+    Reader rec(body.data(), body.size());
+    Event ev;
+    ev.hdr = rec.get<Bin::EventHeader>();
+    ev.source = rec.bytes(ev.hdr.source_len);
+    ev.args = body.substr(sizeof(Bin::EventHeader) + ev.hdr.source_len);
+    events.push_back(ev);
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const Event &lhs, const Event &rhs) {
+                     return lhs.hdr.time_ns < rhs.hdr.time_ns;
+                   });
+
+  std::string out;
+  out.reserve(2 * payload.size());
+  std::array<Arg, 256> args;
+  Spektral::Log::TimestampFormatter ts;
+  for (const Event &ev : events)
+    format_event(out, ev, dict, args.data(), ts);
+  return out;
+}
+
+/// An EVENTS chunk found by index().
+struct Chunk {
+  std::string_view payload;
+  std::uint32_t records;
+};
+
+/**
+ * @brief Walks the chunk headers of a mapped file, filling dict from the DICT
+ * chunks and returning the EVENTS chunks in file order.
+ *
+ * A chunk cut short by a crash ends the walk with a warning.
+ */
+std::vector<Chunk> index(std::string_view file, Dictionary &dict) {
+  Reader in(file.data(), file.size());
+  auto hdr = in.get<Bin::FileHeader>();
+  if (std::memcmp(hdr.magic, Bin::file_magic, sizeof(hdr.magic)) != 0)
+    throw std::runtime_error("Not a BinaryLogger file");
+  if (hdr.version != Bin::format_version)
+    throw std::runtime_error(
+        std::format("Unsupported format version {}", hdr.version));
+
+  std::vector<Chunk> chunks;
+  std::size_t off = sizeof(Bin::FileHeader);
+  while (off < file.size()) {
+    if (file.size() - off < sizeof(Bin::ChunkHeader)) {
+      std::cerr << "logdecode: truncated chunk header at offset " << off
+                << ", stopping\n";
+      break;
+    }
+    Bin::ChunkHeader chunk;
+    std::memcpy(&chunk, file.data() + off, sizeof(chunk));
+    if (chunk.magic != Bin::chunk_magic)
+      throw std::runtime_error(std::format("Bad chunk at offset {}", off));
+    off += sizeof(chunk);
+    if (file.size() - off < chunk.payload_len) {
+      std::cerr << "logdecode: truncated chunk at offset "
+                << off - sizeof(chunk) << ", stopping\n";
+      break;
+    }
+    std::string_view payload = file.substr(off, chunk.payload_len);
+    off += chunk.payload_len;
+
+    if (chunk.type == Bin::ChunkType::EVENTS) {
+      chunks.push_back({payload, chunk.records});
+    } else if (chunk.type == Bin::ChunkType::DICT) {
+      Reader rec(payload.data(), payload.size());
+      for (std::uint32_t ii = 0; ii < chunk.records; ++ii) {
+        auto id = rec.get<std::uint64_t>();
+        dict[id] = rec.bytes(rec.get<std::uint32_t>());
+      }
+    }
+  }
+  return chunks;
+}
+
+/// Writes all of data to fd.
+void write_all(int fd, std::string_view data) {
+  while (!data.empty()) {
+    ssize_t n = ::write(fd, data.data(), data.size());
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error(
+          std::format("write failed: {}", std::strerror(errno)));
+    }
+    data.remove_prefix(static_cast<std::size_t>(n));
+  }
+}
+
+/**
+ * @brief Decodes chunks on `threads` workers and writes them to fd in order.
+ *
+ * Workers never run more than a few chunks ahead of the writer, so memory use
+ * does not grow with the size of the file.
+ */
+void decode(const std::vector<Chunk> &chunks, const Dictionary &dict, int fd,
+            unsigned threads) {
+  const std::size_t window = 4 * threads;
+  std::vector<std::string> results(chunks.size());
+  std::vector<char> ready(chunks.size(), 0);
+  std::mutex mtx;
+  std::condition_variable done_cv, room_cv;
+  std::size_t next = 0, written = 0;
+  std::exception_ptr error;
+
+  auto worker = [&]() {
+    for (;;) {
+      std::size_t idx;
+      {
+        std::unique_lock lock(mtx);
+        room_cv.wait(lock, [&] {
+          return next >= chunks.size() || next < written + window || error;
+        });
+        if (next >= chunks.size() || error)
+          return;
+        idx = next++;
+      }
+      std::string text;
+      try {
+        text = decode_chunk(chunks[idx].payload, chunks[idx].records, dict);
+      } catch (...) {
+        std::lock_guard lock(mtx);
+        if (!error)
+          error = std::current_exception();
+        done_cv.notify_all();
+        room_cv.notify_all();
+        return;
+      }
+      std::lock_guard lock(mtx);
+      results[idx] = std::move(text);
+      ready[idx] = 1;
+      done_cv.notify_all();
+    }
+  };
+
+  std::vector<std::jthread> pool;
+  for (unsigned ii = 0; ii < threads; ++ii)
+    pool.emplace_back(worker);
+
+  for (std::size_t idx = 0; idx < chunks.size(); ++idx) {
+    std::string text;
+    {
+      std::unique_lock lock(mtx);
+      done_cv.wait(lock, [&] { return ready[idx] || error; });
+      if (error)
+        break;
+      text = std::move(results[idx]);
+    }
+    write_all(fd, text);
+    {
+      std::lock_guard lock(mtx);
+      written = idx + 1;
+    }
+    room_cv.notify_all();
+  }
+  pool.clear();
+  if (error)
+    std::rethrow_exception(error);
+}
+
+/// Prints usage to stderr and returns the exit code.
+int usage() {
+  std::cerr << "usage: logdecode <input.bin> [-o <output>] [-j <threads>]\n";
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string input, output;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int ii = 1; ii < argc; ++ii) {
+    std::string_view arg = argv[ii];
+    if (arg == "-o" && ii + 1 < argc)
+      output = argv[++ii];
+    else if (arg == "-j" && ii + 1 < argc)
+      threads = std::max(1, std::atoi(argv[++ii]));
+    else if (input.empty() && !arg.starts_with('-'))
+      input = arg;
+    else
+      return usage();
+  }
+  if (input.empty())
+    return usage();
+
+  try {
+    int in_fd = ::open(input.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in_fd < 0)
+      throw std::runtime_error(std::format("Failed to open file: {}", input));
+    struct stat st;
+    if (::fstat(in_fd, &st) != 0 || st.st_size == 0) {
+      ::close(in_fd);
+      throw std::runtime_error(std::format("Empty file: {}", input));
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+    ::close(in_fd);
+    if (map == MAP_FAILED)
+      throw std::runtime_error(std::format("Failed to map file: {}", input));
+    ::madvise(map, size, MADV_WILLNEED);
+
+    int out_fd = STDOUT_FILENO;
+    if (!output.empty()) {
+      out_fd = ::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                      0644);
+      if (out_fd < 0)
+        throw std::runtime_error(
+            std::format("Failed to open file: {}", output));
+    }
+
+    Dictionary dict;
+    std::string_view file(static_cast<const char *>(map), size);
+    decode(index(file, dict), dict, out_fd, threads);
+
+    if (out_fd != STDOUT_FILENO)
+      ::close(out_fd);
+    ::munmap(map, size);
+  } catch (const std::exception &e) {
+    std::cerr << "logdecode: " << e.what() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,326 @@
+/// @file: tools/logmerge.cpp
+/// @brief: merges the shard files of a ShardedFileLogger (or any FileLogger
+/// files) into one, in timestamp order.
+///
+/// Usage: logmerge <input>... [-w <records>] [-o <output>]
+///
+/// Every input is mapped and split into records: a line starting with a level
+/// ("INFO: ", ...) starts a record and any other line continues the previous
+/// one, so multi-line messages stay in one piece. JSON and logfmt records
+/// (OutputFormat::JSON and LOGFMT) are one line each, starting with their "ts"
+/// field. The records are merged with
+/// a heap keyed by their timestamp, ties going to the earlier input. A
+/// FileLogger fed by several threads at once only sorts each batch, so each
+/// input is read through a reorder window of the next -w records (default:
+/// 65536), which it yields earliest first. The output is exactly ordered as
+/// long as no record is more than a window away from its place in its input.
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+/// The level prefixes LogEvent::format_to() starts a record with.
+constexpr std::array<std::string_view, 5> levels = {
+    "INFO: ", "WARN: ", "DEBUG: ", "ERROR: ", "UNKOWN_LEVEL: "};
+
+/// How many bytes of output are gathered before each write(2).
+constexpr std::size_t write_bytes = 1 << 20;
+
+/// How many records of each input are reordered, unless -w says otherwise.
+constexpr std::size_t default_window = 1 << 16;
+
+/// A memory-mapped input file.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw std::runtime_error(std::format("Failed to open file: {}", path));
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error(std::format("Failed to stat file: {}", path));
+    }
+    _size = static_cast<std::size_t>(st.st_size);
+    if (_size) {
+      _map = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (_map == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error(std::format("Failed to map file: {}", path));
+      }
+      ::madvise(_map, _size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile() {
+    if (_size)
+      ::munmap(_map, _size);
+  }
+
+  std::string_view view() const {
+    return {static_cast<const char *>(_map), _size};
+  }
+
+private:
+  void *_map = nullptr;
+  std::size_t _size = 0;
+};
+
+/// The starts of the JSON and logfmt records, up to their timestamp.
+constexpr std::array<std::string_view, 2> structured = {"{\"ts\":", "ts="};
+
+/// Whether line starts a record, i.e. starts with a level prefix or a "ts"
+/// field.
+bool starts_record(std::string_view line) {
+  for (std::string_view level : levels)
+    if (line.starts_with(level))
+      return true;
+  for (std::string_view start : structured)
+    if (line.starts_with(start))
+      return true;
+  return false;
+}
+
+/**
+ * @brief The timestamp of a record: what follows its level prefix, up to the
+ * first space past the date. TimestampFormat::DEFAULT has a space between the
+ * date and the time of day, ISO8601 and EPOCH_NS have none. In a JSON or
+ * logfmt record, the value of the "ts" field, without quotes.
+ */
+std::string_view timestamp(std::string_view record) {
+  for (std::string_view start : structured) {
+    if (!record.starts_with(start))
+      continue;
+    record.remove_prefix(start.size());
+    // Quoted, or a number (EPOCH_NS), or an unquoted logfmt value.
+    std::size_t end;
+    if (record.starts_with('"')) {
+      record.remove_prefix(1);
+      end = record.find('"');
+    } else {
+      end = record.find_first_of(", \n");
+    }
+    return record.substr(0, end);
+  }
+  if (!starts_record(record))
+    return {};
+  std::size_t start = record.find(": ") + 2;
+  std::size_t end = record.find_first_of(" \n", start + 11);
+  if (end == std::string_view::npos)
+    end = record.size();
+  return record.substr(start, end - start);
+}
+
+/**
+ * @brief Whether timestamp lhs is earlier than rhs. DEFAULT and ISO8601
+ * timestamps of the same precision compare as strings; EPOCH_NS ones are
+ * compared by length first.
+ */
+bool earlier(std::string_view lhs, std::string_view rhs) {
+  if (lhs.size() != rhs.size() &&
+      lhs.find_first_not_of("0123456789") == std::string_view::npos &&
+      rhs.find_first_not_of("0123456789") == std::string_view::npos)
+    return lhs.size() < rhs.size();
+  return lhs < rhs;
+}
+
+/// A record of an input, with its timestamp and its place in the input.
+struct Record {
+  std::string_view text;
+  std::string_view timestamp;
+  std::size_t index;
+};
+
+/// Orders a heap of records so that the earliest one (then the first one in
+/// the input) is on top.
+bool later(const Record &lhs, const Record &rhs) {
+  if (earlier(rhs.timestamp, lhs.timestamp))
+    return true;
+  if (earlier(lhs.timestamp, rhs.timestamp))
+    return false;
+  return lhs.index > rhs.index;
+}
+
+/// Walks the records of one input, earliest first within a reorder window.
+class Cursor {
+public:
+  Cursor(std::string_view file, std::size_t input, std::size_t window)
+      : _file(file), _input(input), _window(window) {
+    // Anything before the first record, e.g. the tail of a message whose
+    // start was rotated away, becomes a record without a timestamp.
+    fill();
+  }
+
+  /// Moves to the next record. Returns false once every record was visited.
+  bool advance() {
+    std::pop_heap(_pending.begin(), _pending.end(), later);
+    _pending.pop_back();
+    fill();
+    return !_pending.empty();
+  }
+
+  /// The current record, empty once every record was visited.
+  std::string_view record() const {
+    return _pending.empty() ? std::string_view() : _pending.front().text;
+  }
+  std::string_view key() const { return _pending.front().timestamp; }
+  std::size_t input() const { return _input; }
+
+private:
+  /// Reads records into the window until it is full or the file ends.
+  void fill() {
+    while (_pending.size() < _window && _next < _file.size()) {
+      std::size_t start = _next, end = start;
+      do {
+        std::size_t eol = _file.find('\n', end);
+        end = eol == std::string_view::npos ? _file.size() : eol + 1;
+      } while (end < _file.size() && !starts_record(_file.substr(end)));
+      std::string_view text = _file.substr(start, end - start);
+      _pending.push_back({text, timestamp(text), _read++});
+      std::push_heap(_pending.begin(), _pending.end(), later);
+      _next = end;
+    }
+  }
+
+  std::string_view _file;
+  std::size_t _input;
+  std::size_t _window;
+  std::size_t _next = 0;
+  /// How many records were read into the window.
+  std::size_t _read = 0;
+  /// The records read but not yet visited, a heap ordered by later().
+  std::vector<Record> _pending;
+};
+
+/// Orders the heap so that the earliest record (then the earliest input) is
+/// on top.
+struct Later {
+  bool operator()(const Cursor *lhs, const Cursor *rhs) const {
+    if (earlier(rhs->key(), lhs->key()))
+      return true;
+    if (earlier(lhs->key(), rhs->key()))
+      return false;
+    return lhs->input() > rhs->input();
+  }
+};
+
+/// Writes all of buf to fd.
+void write_all(int fd, std::string_view buf) {
+  while (!buf.empty()) {
+    ssize_t res = ::write(fd, buf.data(), buf.size());
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error(
+          std::format("Failed to write output: {}", std::strerror(errno)));
+    }
+    buf.remove_prefix(static_cast<std::size_t>(res));
+  }
+}
+
+/// Merges the inputs into out_fd, reordering window records of each.
+void merge(const std::vector<std::string_view> &files, std::size_t window,
+           int out_fd) {
+  std::vector<Cursor> cursors;
+  cursors.reserve(files.size());
+  std::priority_queue<Cursor *, std::vector<Cursor *>, Later> heap;
+  for (std::size_t ii = 0; ii < files.size(); ++ii) {
+    cursors.emplace_back(files[ii], ii, window);
+    if (!cursors.back().record().empty())
+      heap.push(&cursors.back());
+  }
+
+  std::string buffer;
+  buffer.reserve(write_bytes);
+  while (!heap.empty()) {
+    Cursor *top = heap.top();
+    heap.pop();
+    buffer += top->record();
+    if (buffer.size() >= write_bytes) {
+      write_all(out_fd, buffer);
+      buffer.clear();
+    }
+    if (top->advance())
+      heap.push(top);
+  }
+  write_all(out_fd, buffer);
+}
+
+/// Prints usage to stderr and returns the exit code.
+int usage() {
+  std::cerr << "usage: logmerge <input>... [-w <records>] [-o <output>]\n";
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> inputs;
+  std::string output;
+  std::size_t window = default_window;
+  for (int ii = 1; ii < argc; ++ii) {
+    std::string_view arg = argv[ii];
+    if (arg == "-o" && ii + 1 < argc) {
+      output = argv[++ii];
+    } else if (arg == "-w" && ii + 1 < argc) {
+      std::string_view value = argv[++ii];
+      auto [end, ec] = std::from_chars(value.data(),
+                                       value.data() + value.size(), window);
+      if (ec != std::errc() || end != value.data() + value.size() ||
+          window == 0)
+        return usage();
+    } else if (!arg.starts_with('-')) {
+      inputs.emplace_back(arg);
+    } else {
+      return usage();
+    }
+  }
+  if (inputs.empty())
+    return usage();
+
+  try {
+    std::vector<std::unique_ptr<MappedFile>> maps;
+    std::vector<std::string_view> files;
+    for (const auto &input : inputs) {
+      maps.push_back(std::make_unique<MappedFile>(input));
+      files.push_back(maps.back()->view());
+    }
+
+    int out_fd = STDOUT_FILENO;
+    if (!output.empty()) {
+      out_fd = ::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                      0644);
+      if (out_fd < 0)
+        throw std::runtime_error(
+            std::format("Failed to open file: {}", output));
+    }
+
+    merge(files, window, out_fd);
+
+    if (out_fd != STDOUT_FILENO)
+      ::close(out_fd);
+  } catch (const std::exception &e) {
+    std::cerr << "logmerge: " << e.what() << '\n';
+    return 1;
+  }
+}